@@ -0,0 +1,240 @@
+#include "alloc_tracker.hpp"
+
+#ifdef WOTS_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic( _ReturnAddress )
+#define ALLOC_CALL_SITE() _ReturnAddress()
+#else
+#define ALLOC_CALL_SITE() __builtin_return_address( 0 )
+#endif
+
+#include "game.hpp"
+
+
+//-------------------------------------------------------
+//	counters, nothing here may allocate
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr size_t SITES_TABLE_SIZE = 1024;
+
+	thread_local alloc_tracker::Subsystem currentSubsystem = alloc_tracker::SUBSYSTEM_OTHER;
+
+	std::atomic< uint64_t > allocations[ alloc_tracker::SUBSYSTEM_COUNT ];
+	std::atomic< uint64_t > bytes[ alloc_tracker::SUBSYSTEM_COUNT ];
+
+	// open addressing by return address, a zero key is a free slot
+	std::atomic< uintptr_t > siteAddresses[ SITES_TABLE_SIZE ];
+	std::atomic< uint64_t > siteAllocations[ SITES_TABLE_SIZE ];
+
+
+	//-------------------------------------------------------
+	void recordSite( const void *address )
+	{
+		const uintptr_t key = reinterpret_cast< uintptr_t >( address );
+		size_t slot = ( key >> 4 ) * 2654435761u % SITES_TABLE_SIZE;
+		for ( size_t probe = 0; probe < SITES_TABLE_SIZE; ++probe, slot = ( slot + 1 ) % SITES_TABLE_SIZE )
+		{
+			uintptr_t stored = siteAddresses[ slot ].load( std::memory_order_relaxed );
+			if ( stored == 0 && siteAddresses[ slot ].compare_exchange_strong( stored, key, std::memory_order_relaxed ) )
+				stored = key;
+			if ( stored == key )
+			{
+				siteAllocations[ slot ].fetch_add( 1, std::memory_order_relaxed );
+				return;
+			}
+		}
+		// table is full, the allocation is still counted per subsystem
+	}
+
+
+	//-------------------------------------------------------
+	void* allocate( size_t size, const void *callSite )
+	{
+		const alloc_tracker::Subsystem subsystem = currentSubsystem;
+		allocations[ subsystem ].fetch_add( 1, std::memory_order_relaxed );
+		bytes[ subsystem ].fetch_add( size, std::memory_order_relaxed );
+		recordSite( callSite );
+		return std::malloc( size ? size : 1 );
+	}
+}
+
+
+//-------------------------------------------------------
+//	global allocation hooks
+//-------------------------------------------------------
+
+void* operator new( size_t size )
+{
+	void *memory = allocate( size, ALLOC_CALL_SITE() );
+	if ( !memory )
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[]( size_t size )
+{
+	void *memory = allocate( size, ALLOC_CALL_SITE() );
+	if ( !memory )
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new( size_t size, const std::nothrow_t& ) noexcept
+{
+	return allocate( size, ALLOC_CALL_SITE() );
+}
+
+void* operator new[]( size_t size, const std::nothrow_t& ) noexcept
+{
+	return allocate( size, ALLOC_CALL_SITE() );
+}
+
+void operator delete( void *memory ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete[]( void *memory ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete( void *memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete[]( void *memory, size_t ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete( void *memory, const std::nothrow_t& ) noexcept
+{
+	std::free( memory );
+}
+
+void operator delete[]( void *memory, const std::nothrow_t& ) noexcept
+{
+	std::free( memory );
+}
+
+
+//-------------------------------------------------------
+//	public interface
+//-------------------------------------------------------
+
+namespace alloc_tracker
+{
+	Scope::Scope( Subsystem subsystem ) :
+		previous( currentSubsystem )
+	{
+		currentSubsystem = subsystem;
+	}
+
+
+	Scope::~Scope()
+	{
+		currentSubsystem = previous;
+	}
+
+
+	void beginFrame()
+	{
+		// other threads keep allocating, counts racing with the reset go to either frame
+		for ( int i = 0; i < SUBSYSTEM_COUNT; ++i )
+		{
+			allocations[ i ].store( 0, std::memory_order_relaxed );
+			bytes[ i ].store( 0, std::memory_order_relaxed );
+		}
+		for ( size_t i = 0; i < SITES_TABLE_SIZE; ++i )
+		{
+			siteAddresses[ i ].store( 0, std::memory_order_relaxed );
+			siteAllocations[ i ].store( 0, std::memory_order_relaxed );
+		}
+	}
+
+
+	void endFrame( FrameStats &stats )
+	{
+		stats = FrameStats();
+		for ( int i = 0; i < SUBSYSTEM_COUNT; ++i )
+		{
+			stats.subsystems[ i ].allocations = allocations[ i ].load( std::memory_order_relaxed );
+			stats.subsystems[ i ].bytes = bytes[ i ].load( std::memory_order_relaxed );
+			stats.total.allocations += stats.subsystems[ i ].allocations;
+			stats.total.bytes += stats.subsystems[ i ].bytes;
+		}
+
+		// keeps the busiest sites sorted by insertion
+		for ( size_t i = 0; i < SITES_TABLE_SIZE; ++i )
+		{
+			const uintptr_t address = siteAddresses[ i ].load( std::memory_order_relaxed );
+			const uint64_t count = siteAllocations[ i ].load( std::memory_order_relaxed );
+			if ( !address || !count )
+				continue;
+
+			int position = stats.sitesCount;
+			while ( position > 0 && stats.sites[ position - 1 ].allocations < count )
+				--position;
+			if ( position >= MAX_REPORTED_SITES )
+				continue;
+
+			const int last = stats.sitesCount < MAX_REPORTED_SITES ? stats.sitesCount : MAX_REPORTED_SITES - 1;
+			for ( int j = last; j > position; --j )
+				stats.sites[ j ] = stats.sites[ j - 1 ];
+			stats.sites[ position ] = CallSite{ reinterpret_cast< const void* >( address ), count };
+			if ( stats.sitesCount < MAX_REPORTED_SITES )
+				++stats.sitesCount;
+		}
+	}
+
+
+	void logFrame( const FrameStats &stats )
+	{
+		GAME_LOG( game::LOG_INFO, "Allocations: %llu, %llu bytes",
+				  static_cast< unsigned long long >( stats.total.allocations ), static_cast< unsigned long long >( stats.total.bytes ) );
+		for ( int i = 0; i < SUBSYSTEM_COUNT; ++i )
+		{
+			if ( stats.subsystems[ i ].allocations )
+				GAME_LOG( game::LOG_INFO, "  %s: %llu, %llu bytes", toString( static_cast< Subsystem >( i ) ),
+						  static_cast< unsigned long long >( stats.subsystems[ i ].allocations ),
+						  static_cast< unsigned long long >( stats.subsystems[ i ].bytes ) );
+		}
+		for ( int i = 0; i < stats.sitesCount; ++i )
+		{
+			GAME_LOG( game::LOG_INFO, "  site %p: %llu", stats.sites[ i ].address,
+					  static_cast< unsigned long long >( stats.sites[ i ].allocations ) );
+		}
+	}
+
+
+	const char* toString( Subsystem subsystem )
+	{
+		switch ( subsystem )
+		{
+			case SUBSYSTEM_OTHER:
+				return "other";
+			case SUBSYSTEM_GAME:
+				return "game";
+			case SUBSYSTEM_SCENE:
+				return "scene";
+			case SUBSYSTEM_RENDER:
+				return "render";
+			case SUBSYSTEM_STREAM:
+				return "stream";
+			default:
+				return "undefined";
+		}
+	}
+}
+
+#endif
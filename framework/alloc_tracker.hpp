@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	heap allocation tracking
+//	global operator new/delete are hooked in builds with WOTS_TRACK_ALLOCATIONS defined,
+//	otherwise the whole interface compiles to nothing
+//-------------------------------------------------------
+
+namespace alloc_tracker
+{
+#ifdef WOTS_TRACK_ALLOCATIONS
+	constexpr bool ENABLED = true;
+#else
+	constexpr bool ENABLED = false;
+#endif
+
+	enum Subsystem
+	{
+		SUBSYSTEM_OTHER = 0,
+		SUBSYSTEM_GAME,
+		SUBSYSTEM_SCENE,
+		SUBSYSTEM_RENDER,
+		SUBSYSTEM_STREAM,
+		SUBSYSTEM_COUNT
+	};
+
+	constexpr int MAX_REPORTED_SITES = 8;
+
+	struct Counters
+	{
+		uint64_t allocations;
+		uint64_t bytes;
+	};
+
+	// call site is the return address of operator new, resolve it with the map file or a debugger
+	struct CallSite
+	{
+		const void *address;
+		uint64_t allocations;
+	};
+
+	// allocations of all threads between beginFrame and endFrame
+	struct FrameStats
+	{
+		Counters total;
+		Counters subsystems[ SUBSYSTEM_COUNT ];
+		CallSite sites[ MAX_REPORTED_SITES ];
+		int sitesCount;
+	};
+
+
+	// allocations on this thread are attributed to the subsystem while the scope is alive
+	class Scope
+	{
+	public:
+#ifdef WOTS_TRACK_ALLOCATIONS
+		explicit Scope( Subsystem subsystem );
+		~Scope();
+	private:
+		Subsystem previous;
+#else
+		explicit Scope( Subsystem ) {}
+#endif
+	};
+
+
+#ifdef WOTS_TRACK_ALLOCATIONS
+	void beginFrame();
+	void endFrame( FrameStats &stats );
+	void logFrame( const FrameStats &stats );
+	const char* toString( Subsystem subsystem );
+#else
+	inline void beginFrame() {}
+	inline void endFrame( FrameStats &stats ) { stats = FrameStats(); }
+	inline void logFrame( const FrameStats & ) {}
+	inline const char* toString( Subsystem ) { return ""; }
+#endif
+}
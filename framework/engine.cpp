@@ -1,11 +1,194 @@
 
+#include <algorithm>
 #include <cassert>
+#include <atomic>
+#include <thread>
 #include <windows.h>
 #include <windowsx.h>
 #include <GL/gl.h>
 
+#include "alloc_tracker.hpp"
+#include "engine.hpp"
 #include "game.hpp"
+#include "latency_tracker.hpp"
+#include "quality_governor.hpp"
+#include "render.hpp"
 #include "scene.hpp"
+#include "spsc_queue.hpp"
+
+
+//-------------------------------------------------------
+//	input events, produced by the window thread and consumed by the simulation thread
+//-------------------------------------------------------
+
+namespace
+{
+	struct InputEvent
+	{
+		enum Type
+		{
+			KEY_PRESSED,
+			KEY_RELEASED,
+			MOUSE_CLICKED,
+			RESTART,
+			PAN_CAMERA,
+			ZOOM_CAMERA,
+			CENTER_CAMERA,
+			TOGGLE_HUD
+		};
+
+		Type type;
+		uint32_t sequence;
+		int key;
+		float x;
+		float y;
+		bool isLeftButton;
+	};
+
+
+	SpscQueue< InputEvent, 256 > inputEvents;
+	// the game starts with them again on restart
+	game::Outputs gameOutputs;
+
+
+	//-------------------------------------------------------
+	latency_tracker::Source latencySource( InputEvent::Type type )
+	{
+		switch ( type )
+		{
+			case InputEvent::MOUSE_CLICKED:
+				return latency_tracker::SOURCE_MOUSE;
+			case InputEvent::PAN_CAMERA:
+			case InputEvent::ZOOM_CAMERA:
+			case InputEvent::CENTER_CAMERA:
+				return latency_tracker::SOURCE_CAMERA;
+			default:
+				return latency_tracker::SOURCE_KEY;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void pushInput( InputEvent::Type type, int key = 0, float x = 0.f, float y = 0.f, bool isLeftButton = false )
+	{
+		// stamped before the push, the simulation may take the event right away
+		const uint32_t sequence = latency_tracker::inputReceived( latencySource( type ) );
+		// a full queue means the simulation is stalled, dropping input is the lesser evil
+		if ( !inputEvents.push( InputEvent{ type, sequence, key, x, y, isLeftButton } ) )
+			latency_tracker::inputDropped( sequence );
+	}
+
+
+	//-------------------------------------------------------
+	void dispatchInput( const InputEvent &event )
+	{
+		switch ( event.type )
+		{
+			case InputEvent::KEY_PRESSED:
+				game::keyPressed( event.key );
+				break;
+			case InputEvent::KEY_RELEASED:
+				game::keyReleased( event.key );
+				break;
+			case InputEvent::MOUSE_CLICKED:
+				game::mouseClicked( event.x, event.y, event.isLeftButton );
+				break;
+			case InputEvent::RESTART:
+				game::deinit();
+				game::init( gameOutputs );
+				break;
+			case InputEvent::PAN_CAMERA:
+				scene::panCamera( event.x, event.y );
+				break;
+			case InputEvent::ZOOM_CAMERA:
+				scene::zoomCamera( event.x );
+				break;
+			case InputEvent::CENTER_CAMERA:
+				scene::centerCamera();
+				break;
+			case InputEvent::TOGGLE_HUD:
+				scene::toggleHud();
+				break;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void processInputEvents()
+	{
+		InputEvent event;
+		while ( inputEvents.pop( event ) )
+		{
+			latency_tracker::dispatched( event.sequence );
+			dispatchInput( event );
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	allocation test workload: input a player could give, played by simulation time
+//-------------------------------------------------------
+
+namespace
+{
+	struct ScriptedInput
+	{
+		float time;
+		InputEvent event;
+	};
+
+	constexpr ScriptedInput press( float time, int key ) { return ScriptedInput{ time, InputEvent{ InputEvent::KEY_PRESSED, 0, key, 0.f, 0.f, false } }; }
+	constexpr ScriptedInput release( float time, int key ) { return ScriptedInput{ time, InputEvent{ InputEvent::KEY_RELEASED, 0, key, 0.f, 0.f, false } }; }
+	constexpr ScriptedInput click( float time, float x, float y ) { return ScriptedInput{ time, InputEvent{ InputEvent::MOUSE_CLICKED, 0, 0, x, y, true } }; }
+	constexpr ScriptedInput launch( float time ) { return ScriptedInput{ time, InputEvent{ InputEvent::MOUSE_CLICKED, 0, 0, 0.5f, 0.5f, false } }; }
+	constexpr ScriptedInput camera( float time, InputEvent::Type type, float x = 0.f, float y = 0.f ) { return ScriptedInput{ time, InputEvent{ type, 0, 0, x, y, false } }; }
+
+	// clicks are in screen coordinates, the camera follows the selected carrier and other carriers
+	// are below it, so targets are set up and to the right of it. A period has sorties with formations
+	// and bursts, the carrier sailing and turning under them, a new target, the next carrier's sorties,
+	// a recall of everything in view and the camera moved around and back
+	constexpr float SCRIPT_PERIOD = 50.f;
+	const ScriptedInput SCRIPT[] = {
+		click( 0.f, 0.8f, 0.85f ),
+		press( 0.f, game::KEY_FORWARD ),
+		launch( 0.f ), launch( 0.5f ), launch( 1.f ), launch( 1.5f ), launch( 2.f ),
+		press( 5.f, game::KEY_LEFT ), release( 12.f, game::KEY_LEFT ),
+		click( 20.f, 0.9f, 0.6f ),
+		press( 25.f, game::KEY_RIGHT ), release( 32.f, game::KEY_RIGHT ),
+		press( 35.f, game::KEY_NEXT_SHIP ),
+		click( 35.f, 0.7f, 0.9f ),
+		launch( 35.5f ), launch( 36.f ), launch( 36.5f ),
+		camera( 40.f, InputEvent::ZOOM_CAMERA, 1.f / 1.1f ),
+		camera( 41.f, InputEvent::PAN_CAMERA, -0.1f, 0.05f ),
+		press( 43.f, game::KEY_RECALL ),
+		camera( 45.f, InputEvent::CENTER_CAMERA ),
+		camera( 46.f, InputEvent::ZOOM_CAMERA, 1.1f ),
+		camera( 47.f, InputEvent::TOGGLE_HUD ), camera( 48.f, InputEvent::TOGGLE_HUD ),
+		release( 49.f, game::KEY_FORWARD ),
+		// back to the first carrier of four
+		press( 49.f, game::KEY_NEXT_SHIP ), press( 49.f, game::KEY_NEXT_SHIP ), press( 49.f, game::KEY_NEXT_SHIP ),
+	};
+
+	int scriptPeriod = 0;
+	size_t nextScriptedInput = 0;
+
+
+	//-------------------------------------------------------
+	// on the simulation thread, like the input from the window; the script starts over every period
+	void playScript( float time )
+	{
+		const int period = ( int )( time / SCRIPT_PERIOD );
+		if ( period != scriptPeriod )
+		{
+			scriptPeriod = period;
+			nextScriptedInput = 0;
+		}
+		const float periodTime = time - period * SCRIPT_PERIOD;
+		while ( nextScriptedInput < sizeof( SCRIPT ) / sizeof( SCRIPT[ 0 ] ) && SCRIPT[ nextScriptedInput ].time <= periodTime )
+			dispatchInput( SCRIPT[ nextScriptedInput++ ].event );
+	}
+}
 
 
 //-------------------------------------------------------
@@ -18,6 +201,10 @@ namespace
 
 	constexpr int WINDOW_WIDTH = 1024;
 	constexpr int WINDOW_HEIGHT = 768;
+	constexpr float ZOOM_STEP = 1.1f;
+
+	int panLastX = 0;
+	int panLastY = 0;
 
 
 	//-------------------------------------------------------
@@ -31,38 +218,64 @@ namespace
 
 			case WM_KEYDOWN:
 				if ( wParam == 'W' || wParam == VK_UP )
-					game::keyPressed( game::KEY_FORWARD );
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_FORWARD );
 				if ( wParam == 'S' || wParam == VK_DOWN )
-					game::keyPressed( game::KEY_BACKWARD );
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_BACKWARD );
 				if ( wParam == 'A' || wParam == VK_LEFT )
-					game::keyPressed( game::KEY_LEFT );
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
-					game::keyPressed( game::KEY_RIGHT );
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_RIGHT );
+				if ( wParam == VK_TAB )
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_NEXT_SHIP );
+				if ( wParam == 'R' )
+					pushInput( InputEvent::KEY_PRESSED, game::KEY_RECALL );
+				if ( wParam == 'C' )
+					pushInput( InputEvent::CENTER_CAMERA );
+				if ( wParam == 'H' )
+					pushInput( InputEvent::TOGGLE_HUD );
 				if ( wParam == VK_ESCAPE )
 					DestroyWindow( windowHandle );
 				break;
 
 			case WM_KEYUP:
 				if ( wParam == 'W' || wParam == VK_UP )
-					game::keyReleased( game::KEY_FORWARD );
+					pushInput( InputEvent::KEY_RELEASED, game::KEY_FORWARD );
 				if ( wParam == 'S' || wParam == VK_DOWN )
-					game::keyReleased( game::KEY_BACKWARD );
+					pushInput( InputEvent::KEY_RELEASED, game::KEY_BACKWARD );
 				if ( wParam == 'A' || wParam == VK_LEFT )
-					game::keyReleased( game::KEY_LEFT );
+					pushInput( InputEvent::KEY_RELEASED, game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
-					game::keyReleased( game::KEY_RIGHT );
+					pushInput( InputEvent::KEY_RELEASED, game::KEY_RIGHT );
 				if ( wParam == VK_SPACE )
-				{
-					game::deinit();
-					game::init();
-				}
+					pushInput( InputEvent::RESTART );
 				break;
 
 			case WM_LBUTTONUP:
 			case WM_RBUTTONUP:
-				game::mouseClicked( ( float )( GET_X_LPARAM( lParam ) ) / WINDOW_WIDTH,
-									1.f - ( float )( GET_Y_LPARAM( lParam ) ) / WINDOW_HEIGHT,
-									message == WM_LBUTTONUP );
+				pushInput( InputEvent::MOUSE_CLICKED, 0,
+						   ( float )( GET_X_LPARAM( lParam ) ) / WINDOW_WIDTH,
+						   1.f - ( float )( GET_Y_LPARAM( lParam ) ) / WINDOW_HEIGHT,
+						   message == WM_LBUTTONUP );
+				break;
+
+			case WM_MBUTTONDOWN:
+				panLastX = GET_X_LPARAM( lParam );
+				panLastY = GET_Y_LPARAM( lParam );
+				break;
+
+			case WM_MOUSEMOVE:
+				if ( wParam & MK_MBUTTON )
+				{
+					const int x = GET_X_LPARAM( lParam );
+					const int y = GET_Y_LPARAM( lParam );
+					pushInput( InputEvent::PAN_CAMERA, 0, ( float )( x - panLastX ) / WINDOW_WIDTH, -( float )( y - panLastY ) / WINDOW_HEIGHT );
+					panLastX = x;
+					panLastY = y;
+				}
+				break;
+
+			case WM_MOUSEWHEEL:
+				pushInput( InputEvent::ZOOM_CAMERA, 0, GET_WHEEL_DELTA_WPARAM( wParam ) > 0 ? ZOOM_STEP : 1.f / ZOOM_STEP );
 				break;
 		}
 		return DefWindowProc( hwnd, message, wParam, lParam );
@@ -138,6 +351,18 @@ namespace
 {
 	HDC windowDC = nullptr;
 	HGLRC openGLHandle = nullptr;
+	// cost of the last draw, without waiting in SwapBuffers; the quality governor reads it
+	std::atomic< float > drawMs( 0.f );
+
+
+	//-------------------------------------------------------
+	float millisecondsSince( LARGE_INTEGER start )
+	{
+		static LARGE_INTEGER frequency = []{ LARGE_INTEGER value; QueryPerformanceFrequency( &value ); return value; }();
+		LARGE_INTEGER now;
+		QueryPerformanceCounter( &now );
+		return ( float )( 1000.0 * ( now.QuadPart - start.QuadPart ) / frequency.QuadPart );
+	}
 
 
 	//-------------------------------------------------------
@@ -177,8 +402,19 @@ namespace
 	//-------------------------------------------------------
 	void draw()
 	{
-		scene::draw();
+		alloc_tracker::Scope scope( alloc_tracker::SUBSYSTEM_RENDER );
+		uint32_t inputSequence = 0;
+		LARGE_INTEGER drawStart;
+		QueryPerformanceCounter( &drawStart );
+		if ( !scene::draw( &inputSequence ) )
+		{
+			std::this_thread::yield();
+			return;
+		}
+		latency_tracker::drawn( inputSequence );
+		drawMs.store( millisecondsSince( drawStart ), std::memory_order_relaxed );
 		SwapBuffers( windowDC );
+		latency_tracker::presented( inputSequence );
 
 		assert( glGetError() == 0 );
 	}
@@ -193,6 +429,14 @@ namespace
 {
 	constexpr int MAX_FPS = 150;
 
+	// allocation test: frames to let pools and containers reach their capacity, then frames which must not allocate.
+	// The script is played in fixed steps, so the frames cover the same launches, sorties, landings and refuels
+	// on every machine: two periods of the script as warmup, then 200 s under test
+	constexpr float ALLOCATION_TEST_STEP = 1.f / 60.f;
+	constexpr int ALLOCATION_WARMUP_FRAMES = 6000;
+	constexpr int ALLOCATION_TEST_FRAMES = 12000;
+
+	engine::Options options;
 	LARGE_INTEGER clockFrequency;
 	LARGE_INTEGER clockLastTick;
 
@@ -217,14 +461,75 @@ namespace
 			double deltaTime = ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart;
 			if ( deltaTime >= 1.0 / MAX_FPS )
 			{
-				dt = ( float )deltaTime;
+				dt = options.allocationTest ? ALLOCATION_TEST_STEP : ( float )deltaTime;
 				clockLastTick = clockTick;
 				break;
 			}
 		}
 
-		game::update( dt );
-		scene::update( dt );
+		{
+			alloc_tracker::Scope scope( alloc_tracker::SUBSYSTEM_GAME );
+			game::update( dt );
+		}
+		latency_tracker::updated();
+		{
+			alloc_tracker::Scope scope( alloc_tracker::SUBSYSTEM_SCENE );
+			scene::update( dt );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	std::atomic< bool > simulationRunning( false );
+	std::atomic< bool > allocationTestFailed( false );
+
+
+	//-------------------------------------------------------
+	// returns false when the allocation test is over
+	bool checkAllocations( int frame, const alloc_tracker::FrameStats &stats )
+	{
+		if ( frame < ALLOCATION_WARMUP_FRAMES || stats.total.allocations == 0 )
+			return frame < ALLOCATION_WARMUP_FRAMES + ALLOCATION_TEST_FRAMES;
+
+		GAME_LOG( game::LOG_ERROR, "Steady state frame %d allocated", frame );
+		alloc_tracker::logFrame( stats );
+		allocationTestFailed = true;
+		return false;
+	}
+
+
+	//-------------------------------------------------------
+	void simulate()
+	{
+		alloc_tracker::FrameStats allocationStats;
+		int frame = 0;
+		while ( simulationRunning.load( std::memory_order_relaxed ) )
+		{
+			alloc_tracker::beginFrame();
+			{
+				alloc_tracker::Scope scope( alloc_tracker::SUBSYSTEM_GAME );
+				processInputEvents();
+				if ( options.allocationTest )
+					playScript( frame * ALLOCATION_TEST_STEP );
+			}
+			update();
+			{
+				alloc_tracker::Scope scope( alloc_tracker::SUBSYSTEM_SCENE );
+				scene::publish( latency_tracker::lastUpdated() );
+			}
+			alloc_tracker::endFrame( allocationStats );
+
+			// the frame started when update stopped waiting, simulation and render work run in parallel
+			const float frameMs = std::max( millisecondsSince( clockLastTick ), drawMs.load( std::memory_order_relaxed ) );
+			scene::setEffectsLevel( quality_governor::addFrame( frameMs ) );
+			scene::setFrameStats( frameMs );
+
+			if ( options.allocationTest && !checkAllocations( frame++, allocationStats ) )
+			{
+				PostMessage( windowHandle, WM_CLOSE, 0, 0 );
+				return;
+			}
+		}
 	}
 }
 
@@ -235,19 +540,65 @@ namespace
 
 namespace engine
 {
-	void run()
+	int run( const Options &runOptions )
 	{
+		options = runOptions;
+		if ( options.allocationTest && !alloc_tracker::ENABLED )
+		{
+			game::log( game::LOG_ERROR, "Allocation test needs a build with WOTS_TRACK_ALLOCATIONS" );
+			return 1;
+		}
+
+		if ( options.cpuRender )
+			render::setMode( render::Mode::Cpu );
+
 		initWindow();
 		initOGL();
+		scene::init();
 		initClock();
-		game::init();
-		while ( processWindowMessages() )
+		quality_governor::init( options.frameBudgetMs, scene::EFFECTS_LEVELS );
+		// the test streams and records the world too, without a port or a file of the working directory
+		char temporaryRecording[ MAX_PATH ] = "";
+		gameOutputs = game::Outputs();
+		if ( options.allocationTest )
 		{
-			update();
-			draw();
+			gameOutputs.stream = game::Outputs::STREAM_LOOPBACK;
+			gameOutputs.recorderPath = options.allocationTestRecording;
+			char temporaryDirectory[ MAX_PATH ];
+			if ( !gameOutputs.recorderPath && GetTempPathA( MAX_PATH, temporaryDirectory ) &&
+				 GetTempFileNameA( temporaryDirectory, "wfr", 0, temporaryRecording ) )
+				gameOutputs.recorderPath = temporaryRecording;
 		}
+		game::init( gameOutputs );
+
+		// window messages and rendering stay on this thread, it owns the window and the gl context
+		simulationRunning = true;
+		std::thread simulation( simulate );
+		while ( processWindowMessages() )
+			draw();
+		simulationRunning = false;
+		simulation.join();
+
 		game::deinit();
+		if ( temporaryRecording[ 0 ] )
+			DeleteFileA( temporaryRecording );
+		game::log( game::LOG_INFO, render::isInstancingActive() ? "Meshes were drawn instanced" : "Meshes were drawn on the cpu path" );
+		scene::deinit();
 		deinitOGL();
+		quality_governor::logMetrics();
 		deinitWindow();
+
+		if ( options.allocationTest )
+			game::log( allocationTestFailed ? game::LOG_ERROR : game::LOG_INFO,
+					   allocationTestFailed ? "Allocation test failed" : "Allocation test passed" );
+		return allocationTestFailed ? 1 : 0;
+	}
+
+
+	int checkRender()
+	{
+		const bool passed = render::checkTransform();
+		game::log( passed ? game::LOG_INFO : game::LOG_ERROR, passed ? "Render check passed" : "Render check failed" );
+		return passed ? 0 : 1;
 	}
 }
@@ -2,6 +2,20 @@
 
 namespace engine
 {
-	void run();
-}
+	struct Options
+	{
+		// runs a fixed number of frames of scripted input and fails if steady state frames allocate
+		bool allocationTest = false;
+		// the allocation test records flights there, by default to a temporary file removed afterwards
+		const char *allocationTestRecording = nullptr;
+		// cosmetic effects are shed while frames cost more than this
+		float frameBudgetMs = 1000.f / 60.f;
+		// draws through the cpu reference path even if the driver can instance
+		bool cpuRender = false;
+	};
 
+	// returns the process exit code
+	int run( const Options &options = Options() );
+	// headless check of the cpu reference renderer, same exit code convention
+	int checkRender();
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdio>
+
 
 //-------------------------------------------------------
 //	game parameters
@@ -22,6 +24,96 @@ namespace params
 		constexpr int FLIGHT_TIME_SEC = 120;
 		constexpr int FUELING_TIME_SEC = 20;
 		constexpr float FLYBY_DISTANCE = 0.2f;
+		// fired at the target while loitering around it
+		constexpr int BURST_ROUNDS = 6;
+		constexpr float BURST_INTERVAL_SEC = 0.5f;
+	}
+
+	namespace projectile
+	{
+		constexpr float SPEED = 6.f;
+		constexpr float LIFE_SEC = 1.f;
+		// rounds of a burst fan out over this angle
+		constexpr float SPREAD = 0.1f;
+		// target marker of a carrier is a body of this radius
+		constexpr float TARGET_RADIUS = 0.3f;
+	}
+
+	namespace formation
+	{
+		// an aircraft launched while the previous one of its model is this close to the carrier flies in its formation
+		constexpr float JOIN_DISTANCE = 3.f;
+		constexpr int MAX_FOLLOWERS = 4;
+		// slots make a V behind the leader, this far apart along and across its heading
+		constexpr float SLOT_SPACING = 0.35f;
+		// followers aim this far ahead of their slot, turn rate grows with the heading error
+		constexpr float LEAD_DISTANCE = 0.5f;
+		constexpr float TURN_GAIN = 4.f;
+		// followers behind their slot fly up to this much faster than the model's speed
+		constexpr float CATCH_UP_RATIO = 0.3f;
+		constexpr float CATCH_UP_GAIN = 1.5f;
+		// the group breaks up this far outside of the leader's flyby circle, everyone loiters on its own
+		constexpr float BREAK_DISTANCE = 1.f;
+	}
+
+	namespace detail
+	{
+		// aircrafts this close to the view or to where they fly replan steering every frame
+		constexpr float VIEW_MARGIN = 1.f;
+		constexpr float ACTIVE_DISTANCE = 3.f;
+		// others replan every this many frames, the far ones less often
+		constexpr int REDUCED_PERIOD = 4;
+		constexpr int DISTANT_PERIOD = 16;
+		// aircrafts within this distance of the view are not far
+		constexpr float REDUCED_DISTANCE = 10.f;
+		// replans of aircrafts out of the view per frame, over all carriers
+		constexpr int REPLAN_BUDGET = 64;
+	}
+
+	namespace wind
+	{
+		// steady wind over the whole sea plus gusts drifting with it
+		constexpr float BASE_SPEED = 0.15f;
+		constexpr float GUST_SPEED = 0.1f;
+		constexpr float GUST_DRIFT_SPEED = 0.3f;
+		constexpr float CELL_SIZE = 2.f;
+		constexpr unsigned SEED = 7;
+	}
+
+	namespace navigation
+	{
+		// islands are scattered in a ring around the start, returning aircrafts fly around them
+		constexpr int ISLANDS_COUNT = 12;
+		constexpr float ISLANDS_MIN_DISTANCE = 8.f;
+		constexpr float ISLANDS_MAX_DISTANCE = 25.f;
+		constexpr float ISLAND_MIN_RADIUS = 0.5f;
+		constexpr float ISLAND_MAX_RADIUS = 2.f;
+		// cells closer than this to the shore are blocked too
+		constexpr float SHORE_MARGIN = 0.2f;
+		constexpr float CELL_SIZE = 0.5f;
+		constexpr unsigned SEED = 11;
+	}
+
+	namespace world
+	{
+		// carriers start in a row, the first one is selected
+		constexpr int SHIPS_COUNT = 4;
+		constexpr float SHIP_SPACING = 2.f;
+	}
+
+	namespace stream
+	{
+		// world state is streamed to a local spectator over UDP when enabled
+		constexpr bool ENABLED = false;
+		constexpr unsigned short PUBLISHER_PORT = 27015;
+		constexpr unsigned short SPECTATOR_PORT = 27016;
+	}
+
+	namespace recorder
+	{
+		// every tick of the world is written to the file when enabled, see --dump-flights
+		constexpr bool ENABLED = false;
+		constexpr const char *PATH = "flights.wfr";
 	}
 }
 
@@ -31,7 +123,24 @@ namespace params
 
 namespace game
 {
-	void init();
+	// where the world goes besides the screen, by default as params::stream and params::recorder have it
+	struct Outputs
+	{
+		enum Stream
+		{
+			STREAM_NONE,
+			// UDP to a spectator on this machine
+			STREAM_UDP,
+			// an in-process loopback nobody reads, datagrams are dropped once its queue is full
+			STREAM_LOOPBACK
+		};
+
+		Stream stream = params::stream::ENABLED ? STREAM_UDP : STREAM_NONE;
+		// flight recorder file, nullptr records nothing
+		const char *recorderPath = params::recorder::ENABLED ? params::recorder::PATH : nullptr;
+	};
+
+	void init( const Outputs &outputs = Outputs() );
 	void deinit();
 	void update( float dt );
 
@@ -41,6 +150,8 @@ namespace game
 		KEY_BACKWARD,
 		KEY_LEFT,
 		KEY_RIGHT,
+		KEY_NEXT_SHIP,
+		KEY_RECALL,
 		KEY_COUNT
 	};
 
@@ -61,7 +172,7 @@ namespace game
 	{ \
 		constexpr int BUF_SIZE = 1048;\
 		char buffer[BUF_SIZE];\
-		sprintf_s(buffer, format, __VA_ARGS__);\
+		snprintf(buffer, BUF_SIZE, format, __VA_ARGS__);\
 		log(level, buffer);\
 	}
 }
@@ -0,0 +1,274 @@
+#include "latency_tracker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+
+#include "game.hpp"
+
+
+//-------------------------------------------------------
+//	events in flight
+//	each stamp array is written by one thread only, the render thread reads
+//	simulation stamps after it acquired a snapshot, so they are already visible
+//-------------------------------------------------------
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// as deep as the input queue, an event can not be overwritten while it is in flight
+	constexpr uint32_t EVENTS_IN_FLIGHT = 256;
+	constexpr int SOURCE_DROPPED = latency_tracker::SOURCE_COUNT;
+
+	// window thread
+	uint32_t lastReceived = 0;
+	Clock::time_point inputTimes[ EVENTS_IN_FLIGHT ];
+	int sources[ EVENTS_IN_FLIGHT ];
+
+	// simulation thread
+	uint32_t lastDispatched = 0;
+	uint32_t lastUpdatedSequence = 0;
+	Clock::time_point dispatchTimes[ EVENTS_IN_FLIGHT ];
+	Clock::time_point updateTimes[ EVENTS_IN_FLIGHT ];
+
+	// render thread
+	uint32_t lastDrawn = 0;
+	uint32_t lastPresented = 0;
+	Clock::time_point drawTimes[ EVENTS_IN_FLIGHT ];
+
+
+	inline uint32_t slot( uint32_t sequence )
+	{
+		return sequence % EVENTS_IN_FLIGHT;
+	}
+}
+
+
+//-------------------------------------------------------
+//	statistics
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr double BUCKET_MS = 0.25;
+	// the last bucket takes everything above 100 ms
+	constexpr int BUCKETS = 400;
+	constexpr double SUMMARY_PERIOD_SEC = 10.0;
+
+	struct Histogram
+	{
+		uint64_t buckets[ BUCKETS ];
+		uint64_t count;
+		double sumMs;
+		double maxMs;
+
+		void add( double ms )
+		{
+			const int bucket = std::min( static_cast< int >( ms / BUCKET_MS ), BUCKETS - 1 );
+			++buckets[ bucket ];
+			++count;
+			sumMs += ms;
+			maxMs = std::max( maxMs, ms );
+		}
+
+		double percentile( double fraction ) const
+		{
+			const uint64_t rank = static_cast< uint64_t >( fraction * ( count - 1 ) ) + 1;
+			uint64_t seen = 0;
+			for ( int i = 0; i < BUCKETS - 1; ++i )
+			{
+				seen += buckets[ i ];
+				if ( seen >= rank )
+					return std::min( ( i + 1 ) * BUCKET_MS, maxMs );
+			}
+			return maxMs;
+		}
+	};
+
+	std::mutex statsMutex;
+	Histogram histograms[ latency_tracker::SOURCE_COUNT ][ latency_tracker::STAGE_COUNT ];
+	// render thread only
+	Clock::time_point lastSummaryTime = Clock::now();
+	bool hasNewEvents = false;
+
+
+	double millisecondsBetween( Clock::time_point from, Clock::time_point to )
+	{
+		return std::chrono::duration< double, std::milli >( to - from ).count();
+	}
+
+
+	void record( uint32_t sequence, Clock::time_point presentTime )
+	{
+		const uint32_t index = slot( sequence );
+		if ( sources[ index ] == SOURCE_DROPPED )
+			return;
+
+		const Clock::time_point input = inputTimes[ index ];
+		Histogram *stages = histograms[ sources[ index ] ];
+		stages[ latency_tracker::STAGE_DISPATCH ].add( millisecondsBetween( input, dispatchTimes[ index ] ) );
+		stages[ latency_tracker::STAGE_UPDATE ].add( millisecondsBetween( input, updateTimes[ index ] ) );
+		stages[ latency_tracker::STAGE_DRAW ].add( millisecondsBetween( input, drawTimes[ index ] ) );
+		stages[ latency_tracker::STAGE_PRESENT ].add( millisecondsBetween( input, presentTime ) );
+		hasNewEvents = true;
+	}
+}
+
+
+//-------------------------------------------------------
+//	public interface
+//-------------------------------------------------------
+
+namespace latency_tracker
+{
+	uint32_t inputReceived( Source source )
+	{
+		// zero means no event, it is skipped when the counter wraps
+		if ( ++lastReceived == 0 )
+			++lastReceived;
+		const uint32_t index = slot( lastReceived );
+		inputTimes[ index ] = Clock::now();
+		sources[ index ] = source;
+		return lastReceived;
+	}
+
+
+	void inputDropped( uint32_t sequence )
+	{
+		sources[ slot( sequence ) ] = SOURCE_DROPPED;
+	}
+
+
+	void dispatched( uint32_t sequence )
+	{
+		dispatchTimes[ slot( sequence ) ] = Clock::now();
+		lastDispatched = sequence;
+	}
+
+
+	void updated()
+	{
+		if ( lastUpdatedSequence == lastDispatched )
+			return;
+		const Clock::time_point now = Clock::now();
+		for ( uint32_t sequence = lastUpdatedSequence + 1; sequence != lastDispatched + 1; ++sequence )
+			updateTimes[ slot( sequence ) ] = now;
+		lastUpdatedSequence = lastDispatched;
+	}
+
+
+	uint32_t lastUpdated()
+	{
+		return lastUpdatedSequence;
+	}
+
+
+	void drawn( uint32_t sequence )
+	{
+		if ( sequence == lastDrawn || sequence == 0 )
+			return;
+		const Clock::time_point now = Clock::now();
+		for ( uint32_t drawnSequence = lastDrawn + 1; drawnSequence != sequence + 1; ++drawnSequence )
+			drawTimes[ slot( drawnSequence ) ] = now;
+		lastDrawn = sequence;
+	}
+
+
+	void presented( uint32_t sequence )
+	{
+		const Clock::time_point now = Clock::now();
+		if ( sequence != lastPresented && sequence != 0 )
+		{
+			std::lock_guard< std::mutex > lock( statsMutex );
+			for ( uint32_t presentedSequence = lastPresented + 1; presentedSequence != sequence + 1; ++presentedSequence )
+				record( presentedSequence, now );
+			lastPresented = sequence;
+		}
+
+		if ( hasNewEvents && now - lastSummaryTime >= std::chrono::duration< double >( SUMMARY_PERIOD_SEC ) )
+		{
+			logSummary();
+			lastSummaryTime = now;
+			hasNewEvents = false;
+		}
+	}
+
+
+	Summary summary( Source source )
+	{
+		std::lock_guard< std::mutex > lock( statsMutex );
+		Summary result;
+		for ( int stage = 0; stage < STAGE_COUNT; ++stage )
+		{
+			const Histogram &histogram = histograms[ source ][ stage ];
+			Distribution &distribution = result.stages[ stage ];
+			distribution.count = histogram.count;
+			if ( histogram.count == 0 )
+			{
+				distribution.meanMs = distribution.p50Ms = distribution.p90Ms = distribution.p99Ms = distribution.maxMs = 0.0;
+				continue;
+			}
+			distribution.meanMs = histogram.sumMs / histogram.count;
+			distribution.p50Ms = histogram.percentile( 0.5 );
+			distribution.p90Ms = histogram.percentile( 0.9 );
+			distribution.p99Ms = histogram.percentile( 0.99 );
+			distribution.maxMs = histogram.maxMs;
+		}
+		return result;
+	}
+
+
+	void reset()
+	{
+		std::lock_guard< std::mutex > lock( statsMutex );
+		std::fill_n( &histograms[ 0 ][ 0 ], SOURCE_COUNT * STAGE_COUNT, Histogram() );
+	}
+
+
+	void logSummary()
+	{
+		for ( int source = 0; source < SOURCE_COUNT; ++source )
+		{
+			const Summary sourceSummary = summary( static_cast< Source >( source ) );
+			const Distribution &present = sourceSummary.stages[ STAGE_PRESENT ];
+			if ( present.count == 0 )
+				continue;
+			GAME_LOG( game::LOG_INFO, "Latency %s: %llu events, p50 %.1f p90 %.1f p99 %.1f max %.1f ms",
+					  toString( static_cast< Source >( source ) ), static_cast< unsigned long long >( present.count ),
+					  present.p50Ms, present.p90Ms, present.p99Ms, present.maxMs );
+			for ( int stage = 0; stage < STAGE_PRESENT; ++stage )
+			{
+				const Distribution &distribution = sourceSummary.stages[ stage ];
+				GAME_LOG( game::LOG_INFO, "  to %s: p50 %.1f p99 %.1f ms", toString( static_cast< Stage >( stage ) ),
+						  distribution.p50Ms, distribution.p99Ms );
+			}
+		}
+	}
+
+
+	const char* toString( Source source )
+	{
+		switch ( source )
+		{
+			case SOURCE_KEY: return "key";
+			case SOURCE_MOUSE: return "mouse";
+			case SOURCE_CAMERA: return "camera";
+			default: return "unknown";
+		}
+	}
+
+
+	const char* toString( Stage stage )
+	{
+		switch ( stage )
+		{
+			case STAGE_DISPATCH: return "dispatch";
+			case STAGE_UPDATE: return "update";
+			case STAGE_DRAW: return "draw";
+			case STAGE_PRESENT: return "present";
+			default: return "unknown";
+		}
+	}
+}
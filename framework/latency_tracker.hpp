@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	input to photon latency tracking
+//	every input event gets a sequence number and a timestamp on the window thread,
+//	the number travels with the event to the simulation and with the published
+//	snapshot to the render thread, which completes the trace after SwapBuffers
+//-------------------------------------------------------
+
+namespace latency_tracker
+{
+	enum Source
+	{
+		SOURCE_KEY = 0,
+		SOURCE_MOUSE,
+		SOURCE_CAMERA,
+		SOURCE_COUNT
+	};
+
+	// every stage is measured from the input timestamp
+	enum Stage
+	{
+		STAGE_DISPATCH = 0,	// game or scene got the event
+		STAGE_UPDATE,		// end of the first update which consumed it
+		STAGE_DRAW,			// end of the first draw of a snapshot which reflects it
+		STAGE_PRESENT,		// SwapBuffers of that draw returned
+		STAGE_COUNT
+	};
+
+	// percentiles are upper bounds of histogram buckets, mean and max are exact
+	struct Distribution
+	{
+		uint64_t count;
+		double meanMs;
+		double p50Ms;
+		double p90Ms;
+		double p99Ms;
+		double maxMs;
+	};
+
+	struct Summary
+	{
+		Distribution stages[ STAGE_COUNT ];
+	};
+
+	// window thread, or whoever feeds input in a headless run: stamps a new event
+	uint32_t inputReceived( Source source );
+	// the event did not make it to the simulation, it is left out of the statistics
+	void inputDropped( uint32_t sequence );
+
+	// simulation thread: events are dispatched in the order they were received
+	void dispatched( uint32_t sequence );
+	// marks the end of the update for everything dispatched since the previous call
+	void updated();
+	// the latest event a snapshot published now reflects, 0 if there were none
+	uint32_t lastUpdated();
+
+	// render thread: a snapshot reflecting events up to the sequence was drawn, then presented
+	void drawn( uint32_t sequence );
+	void presented( uint32_t sequence );
+
+	// safe from any thread; reset drops everything collected so far
+	Summary summary( Source source );
+	void reset();
+	void logSummary();
+
+	const char* toString( Source source );
+	const char* toString( Stage stage );
+}
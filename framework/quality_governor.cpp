@@ -0,0 +1,93 @@
+#include "quality_governor.hpp"
+
+#include <cstdio>
+#include <mutex>
+
+#include "game.hpp"
+
+
+namespace
+{
+	constexpr float SMOOTHING = 0.1f;
+	// shed above this fraction of the budget, restore below that one
+	constexpr float DOWNGRADE_RATIO = 1.1f;
+	constexpr float UPGRADE_RATIO = 0.7f;
+	// the condition has to hold this many frames in a row
+	constexpr int DOWNGRADE_FRAMES = 30;
+	constexpr int UPGRADE_FRAMES = 300;
+	// no decisions while the average settles after a change
+	constexpr int SETTLE_FRAMES = 60;
+
+	std::mutex metricsMutex;
+	quality_governor::Metrics current;
+	int levelsCount = 1;
+	int framesOver = 0;
+	int framesUnder = 0;
+	int framesToSettle = 0;
+
+
+	void changeLevel( int level )
+	{
+		const bool isDowngrade = level > current.level;
+		current.level = level;
+		++( isDowngrade ? current.downgrades : current.upgrades );
+		framesOver = framesUnder = 0;
+		framesToSettle = SETTLE_FRAMES;
+		GAME_LOG( game::LOG_INFO, "Effects level %d, frame %.1f ms of %.1f ms budget", level, current.frameMs, current.budgetMs );
+	}
+}
+
+
+namespace quality_governor
+{
+	void init( float budgetMs, int levels )
+	{
+		std::lock_guard< std::mutex > lock( metricsMutex );
+		current = Metrics();
+		current.budgetMs = budgetMs;
+		current.frameMs = budgetMs;
+		levelsCount = levels;
+		framesOver = framesUnder = framesToSettle = 0;
+	}
+
+
+	int addFrame( float frameMs )
+	{
+		std::lock_guard< std::mutex > lock( metricsMutex );
+		current.frameMs += SMOOTHING * ( frameMs - current.frameMs );
+		++current.frames;
+		if ( frameMs > current.budgetMs )
+			++current.framesOverBudget;
+
+		if ( framesToSettle > 0 )
+		{
+			--framesToSettle;
+			return current.level;
+		}
+
+		framesOver = current.frameMs > DOWNGRADE_RATIO * current.budgetMs ? framesOver + 1 : 0;
+		framesUnder = current.frameMs < UPGRADE_RATIO * current.budgetMs ? framesUnder + 1 : 0;
+		if ( framesOver >= DOWNGRADE_FRAMES && current.level < levelsCount - 1 )
+			changeLevel( current.level + 1 );
+		else if ( framesUnder >= UPGRADE_FRAMES && current.level > 0 )
+			changeLevel( current.level - 1 );
+		return current.level;
+	}
+
+
+	Metrics metrics()
+	{
+		std::lock_guard< std::mutex > lock( metricsMutex );
+		return current;
+	}
+
+
+	void logMetrics()
+	{
+		const Metrics snapshot = metrics();
+		GAME_LOG( game::LOG_INFO, "Effects level %d, frame %.1f ms of %.1f ms budget, %llu of %llu frames over, %u downgrades, %u upgrades",
+				  snapshot.level, snapshot.frameMs, snapshot.budgetMs,
+				  static_cast< unsigned long long >( snapshot.framesOverBudget ), static_cast< unsigned long long >( snapshot.frames ),
+				  snapshot.downgrades, snapshot.upgrades );
+	}
+}
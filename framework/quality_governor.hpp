@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	quality governor
+//	watches smoothed frame cost against a budget and picks an effects level:
+//	0 is full quality, higher levels shed cosmetic work, simulation is never touched.
+//	Levels go down quickly when frames run long and come back slowly with headroom.
+//-------------------------------------------------------
+
+namespace quality_governor
+{
+	struct Metrics
+	{
+		int level;
+		float budgetMs;
+		// exponential moving average of the frame cost
+		float frameMs;
+		uint64_t frames;
+		uint64_t framesOverBudget;
+		uint32_t downgrades;
+		uint32_t upgrades;
+	};
+
+	void init( float budgetMs, int levelsCount );
+
+	// simulation thread: cost of the frame, the slower of simulation and render work;
+	// returns the effects level for the next frame
+	int addFrame( float frameMs );
+
+	// safe from any thread
+	Metrics metrics();
+	void logMetrics();
+}
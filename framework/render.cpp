@@ -0,0 +1,374 @@
+#include <windows.h>
+#include <GL/gl.h>
+
+#include <cmath>
+#include <cstddef>
+
+#include "game.hpp"
+#include "render.hpp"
+
+
+//-------------------------------------------------------
+//	opengl 3.3 entry points, gl.h on windows stops at 1.1
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr GLenum ARRAY_BUFFER = 0x8892;
+	constexpr GLenum STATIC_DRAW = 0x88E4;
+	constexpr GLenum STREAM_DRAW = 0x88E0;
+	constexpr GLenum VERTEX_SHADER = 0x8B31;
+	constexpr GLenum FRAGMENT_SHADER = 0x8B30;
+	constexpr GLenum COMPILE_STATUS = 0x8B81;
+	constexpr GLenum LINK_STATUS = 0x8B82;
+
+	typedef char GLchar_;
+	typedef std::ptrdiff_t GLsizeiptr_;
+
+	struct
+	{
+		void ( APIENTRY *genBuffers )( GLsizei, GLuint* );
+		void ( APIENTRY *bindBuffer )( GLenum, GLuint );
+		void ( APIENTRY *bufferData )( GLenum, GLsizeiptr_, void const*, GLenum );
+		GLuint ( APIENTRY *createShader )( GLenum );
+		void ( APIENTRY *shaderSource )( GLuint, GLsizei, GLchar_ const* const*, GLint const* );
+		void ( APIENTRY *compileShader )( GLuint );
+		void ( APIENTRY *getShaderiv )( GLuint, GLenum, GLint* );
+		GLuint ( APIENTRY *createProgram )();
+		void ( APIENTRY *attachShader )( GLuint, GLuint );
+		void ( APIENTRY *linkProgram )( GLuint );
+		void ( APIENTRY *getProgramiv )( GLuint, GLenum, GLint* );
+		void ( APIENTRY *useProgram )( GLuint );
+		GLint ( APIENTRY *getAttribLocation )( GLuint, GLchar_ const* );
+		void ( APIENTRY *enableVertexAttribArray )( GLuint );
+		void ( APIENTRY *disableVertexAttribArray )( GLuint );
+		void ( APIENTRY *vertexAttribPointer )( GLuint, GLint, GLenum, GLboolean, GLsizei, void const* );
+		void ( APIENTRY *vertexAttribDivisor )( GLuint, GLuint );
+		void ( APIENTRY *drawArraysInstanced )( GLenum, GLint, GLsizei, GLsizei );
+	} gl;
+
+
+	template< class Func >
+	bool loadFunction( Func &func, char const *name )
+	{
+		void *address = ( void* )wglGetProcAddress( name );
+		// some drivers return small integers instead of null
+		if ( address == nullptr || address == ( void* )1 || address == ( void* )2 || address == ( void* )3 || address == ( void* )-1 )
+			return false;
+		func = reinterpret_cast< Func >( address );
+		return true;
+	}
+
+
+	char const *VERTEX_SHADER_SOURCE =
+		"#version 120\n"
+		"attribute vec2 position;\n"
+		"attribute vec3 color;\n"
+		"attribute vec3 instance;\n"
+		"varying vec3 vertexColor;\n"
+		"void main()\n"
+		"{\n"
+		"	float c = cos( instance.z );\n"
+		"	float s = sin( instance.z );\n"
+		"	vec2 world = vec2( c * position.x - s * position.y, s * position.x + c * position.y ) + instance.xy;\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * vec4( world, 0.0, 1.0 );\n"
+		"	vertexColor = color;\n"
+		"}\n";
+
+	char const *FRAGMENT_SHADER_SOURCE =
+		"#version 120\n"
+		"varying vec3 vertexColor;\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = vec4( vertexColor, 1.0 );\n"
+		"}\n";
+
+
+	enum class Support
+	{
+		Unknown,
+		Available,
+		Unavailable
+	};
+
+	Support instancingSupport = Support::Unknown;
+	render::Mode mode = render::Mode::Auto;
+
+	GLuint program = 0;
+	GLint positionAttribute = -1;
+	GLint colorAttribute = -1;
+	GLint instanceAttribute = -1;
+
+
+	GLuint compileShader( GLenum type, char const *source )
+	{
+		GLuint shader = gl.createShader( type );
+		gl.shaderSource( shader, 1, &source, nullptr );
+		gl.compileShader( shader );
+		GLint status = 0;
+		gl.getShaderiv( shader, COMPILE_STATUS, &status );
+		return status ? shader : 0;
+	}
+
+
+	bool initInstancing()
+	{
+		bool loaded = loadFunction( gl.genBuffers, "glGenBuffers" ) &&
+			loadFunction( gl.bindBuffer, "glBindBuffer" ) &&
+			loadFunction( gl.bufferData, "glBufferData" ) &&
+			loadFunction( gl.createShader, "glCreateShader" ) &&
+			loadFunction( gl.shaderSource, "glShaderSource" ) &&
+			loadFunction( gl.compileShader, "glCompileShader" ) &&
+			loadFunction( gl.getShaderiv, "glGetShaderiv" ) &&
+			loadFunction( gl.createProgram, "glCreateProgram" ) &&
+			loadFunction( gl.attachShader, "glAttachShader" ) &&
+			loadFunction( gl.linkProgram, "glLinkProgram" ) &&
+			loadFunction( gl.getProgramiv, "glGetProgramiv" ) &&
+			loadFunction( gl.useProgram, "glUseProgram" ) &&
+			loadFunction( gl.getAttribLocation, "glGetAttribLocation" ) &&
+			loadFunction( gl.enableVertexAttribArray, "glEnableVertexAttribArray" ) &&
+			loadFunction( gl.disableVertexAttribArray, "glDisableVertexAttribArray" ) &&
+			loadFunction( gl.vertexAttribPointer, "glVertexAttribPointer" ) &&
+			loadFunction( gl.vertexAttribDivisor, "glVertexAttribDivisor" ) &&
+			loadFunction( gl.drawArraysInstanced, "glDrawArraysInstanced" );
+		if ( !loaded )
+			return false;
+
+		GLuint vertexShader = compileShader( VERTEX_SHADER, VERTEX_SHADER_SOURCE );
+		GLuint fragmentShader = compileShader( FRAGMENT_SHADER, FRAGMENT_SHADER_SOURCE );
+		if ( !vertexShader || !fragmentShader )
+			return false;
+
+		program = gl.createProgram();
+		gl.attachShader( program, vertexShader );
+		gl.attachShader( program, fragmentShader );
+		gl.linkProgram( program );
+		GLint status = 0;
+		gl.getProgramiv( program, LINK_STATUS, &status );
+		if ( !status )
+			return false;
+
+		positionAttribute = gl.getAttribLocation( program, "position" );
+		colorAttribute = gl.getAttribLocation( program, "color" );
+		instanceAttribute = gl.getAttribLocation( program, "instance" );
+		return positionAttribute >= 0 && colorAttribute >= 0 && instanceAttribute >= 0;
+	}
+
+
+	bool useInstancing()
+	{
+		if ( mode == render::Mode::Cpu )
+			return false;
+		if ( instancingSupport == Support::Unknown )
+			instancingSupport = initInstancing() ? Support::Available : Support::Unavailable;
+		return instancingSupport == Support::Available;
+	}
+
+
+	render::Vertex bake( render::Vertex vertex, float c, float s, float scale )
+	{
+		render::Vertex result = vertex;
+		result.x = scale * ( c * vertex.x - s * vertex.y );
+		result.y = scale * ( s * vertex.x + c * vertex.y );
+		return result;
+	}
+}
+
+
+//-------------------------------------------------------
+//	InstanceBatch
+//-------------------------------------------------------
+
+namespace render
+{
+	InstanceBatch::InstanceBatch( GeometryDesc const &desc ) :
+		lineWidth( desc.lineWidth )
+	{
+		const float c = std::cos( desc.rotation );
+		const float s = std::sin( desc.rotation );
+
+		for ( int i = 0; i < desc.triangleCount; ++i )
+			triangles.push_back( bake( desc.triangles[ i ], c, s, desc.scale ) );
+
+		// outline loop is unrolled into separate segments, so instances do not connect
+		for ( int i = 0; i < desc.outlineCount; ++i )
+		{
+			lines.push_back( bake( desc.outline[ i ], c, s, desc.scale ) );
+			lines.push_back( bake( desc.outline[ ( i + 1 ) % desc.outlineCount ], c, s, desc.scale ) );
+		}
+	}
+
+
+	void InstanceBatch::transform( std::vector< Instance > const &instances, std::vector< Vertex > &out ) const
+	{
+		const size_t count = instances.size();
+		out.resize( count * ( triangles.size() + lines.size() ) );
+
+		Vertex *triangleOut = out.data();
+		Vertex *lineOut = out.data() + count * triangles.size();
+		for ( Instance const &instance : instances )
+		{
+			const float c = std::cos( instance.angle );
+			const float s = std::sin( instance.angle );
+			for ( Vertex const &vertex : triangles )
+			{
+				*triangleOut = vertex;
+				triangleOut->x = c * vertex.x - s * vertex.y + instance.x;
+				triangleOut->y = s * vertex.x + c * vertex.y + instance.y;
+				++triangleOut;
+			}
+			for ( Vertex const &vertex : lines )
+			{
+				*lineOut = vertex;
+				lineOut->x = c * vertex.x - s * vertex.y + instance.x;
+				lineOut->y = s * vertex.x + c * vertex.y + instance.y;
+				++lineOut;
+			}
+		}
+	}
+
+
+	void InstanceBatch::draw( std::vector< Instance > const &instances )
+	{
+		if ( instances.empty() )
+			return;
+
+		glLoadIdentity();
+		if ( useInstancing() )
+			drawInstanced( instances );
+		else
+			drawCpu( instances );
+	}
+
+
+	void InstanceBatch::drawCpu( std::vector< Instance > const &instances )
+	{
+		transform( instances, transformed );
+
+		const GLsizei triangleVertices = ( GLsizei )( instances.size() * triangles.size() );
+		const GLsizei lineVertices = ( GLsizei )( instances.size() * lines.size() );
+
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, sizeof( Vertex ), &transformed[ 0 ].x );
+		glColorPointer( 3, GL_FLOAT, sizeof( Vertex ), &transformed[ 0 ].r );
+		glDrawArrays( GL_TRIANGLES, 0, triangleVertices );
+		glLineWidth( lineWidth );
+		glDrawArrays( GL_LINES, triangleVertices, lineVertices );
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+	}
+
+
+	void InstanceBatch::upload()
+	{
+		std::vector< Vertex > geometry( triangles );
+		geometry.insert( geometry.end(), lines.begin(), lines.end() );
+
+		gl.genBuffers( 1, &geometryBuffer );
+		gl.bindBuffer( ARRAY_BUFFER, geometryBuffer );
+		gl.bufferData( ARRAY_BUFFER, geometry.size() * sizeof( Vertex ), geometry.data(), STATIC_DRAW );
+		gl.genBuffers( 1, &instanceBuffer );
+	}
+
+
+	void InstanceBatch::drawInstanced( std::vector< Instance > const &instances )
+	{
+		if ( !geometryBuffer )
+			upload();
+
+		gl.useProgram( program );
+
+		gl.bindBuffer( ARRAY_BUFFER, geometryBuffer );
+		gl.enableVertexAttribArray( positionAttribute );
+		gl.enableVertexAttribArray( colorAttribute );
+		gl.vertexAttribPointer( positionAttribute, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( void const* )offsetof( Vertex, x ) );
+		gl.vertexAttribPointer( colorAttribute, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( void const* )offsetof( Vertex, r ) );
+
+		// the only per frame upload: packed x, y, angle of every instance
+		gl.bindBuffer( ARRAY_BUFFER, instanceBuffer );
+		gl.bufferData( ARRAY_BUFFER, instances.size() * sizeof( Instance ), instances.data(), STREAM_DRAW );
+		gl.enableVertexAttribArray( instanceAttribute );
+		gl.vertexAttribPointer( instanceAttribute, 3, GL_FLOAT, GL_FALSE, sizeof( Instance ), nullptr );
+		gl.vertexAttribDivisor( instanceAttribute, 1 );
+
+		gl.drawArraysInstanced( GL_TRIANGLES, 0, ( GLsizei )triangles.size(), ( GLsizei )instances.size() );
+		glLineWidth( lineWidth );
+		gl.drawArraysInstanced( GL_LINES, ( GLsizei )triangles.size(), ( GLsizei )lines.size(), ( GLsizei )instances.size() );
+
+		gl.vertexAttribDivisor( instanceAttribute, 0 );
+		gl.disableVertexAttribArray( instanceAttribute );
+		gl.disableVertexAttribArray( colorAttribute );
+		gl.disableVertexAttribArray( positionAttribute );
+		gl.bindBuffer( ARRAY_BUFFER, 0 );
+		gl.useProgram( 0 );
+	}
+}
+
+
+//-------------------------------------------------------
+//	mode selection
+//-------------------------------------------------------
+
+namespace render
+{
+	void setMode( Mode newMode )
+	{
+		mode = newMode;
+	}
+
+
+	bool isInstancingActive()
+	{
+		return mode != Mode::Cpu && instancingSupport == Support::Available;
+	}
+}
+
+
+//-------------------------------------------------------
+//	reference path check
+//-------------------------------------------------------
+
+namespace render
+{
+	bool checkTransform()
+	{
+		constexpr float HALF_PI = 1.5707963f;
+		constexpr float EPS = 1e-5f;
+
+		// a corner triangle and one outline edge, baked a quarter turn and twice the size
+		const Vertex triangle[] = { { 1.f, 0.f, 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 0.f, 1.f } };
+		const Vertex outline[] = { { 1.f, 0.f, 1.f, 1.f, 1.f }, { 0.f, 1.f, 1.f, 1.f, 1.f } };
+		const InstanceBatch batch( GeometryDesc{ triangle, 3, outline, 2, HALF_PI, 2.f, 1.f } );
+		const std::vector< Instance > instances = { { 0.f, 0.f, 0.f }, { 10.f, 5.f, -HALF_PI } };
+
+		// baked: ( 1, 0 ) -> ( 0, 2 ), ( 0, 1 ) -> ( -2, 0 ); the second instance turns them back and moves by ( 10, 5 )
+		const Vertex expected[] =
+		{
+			{ 0.f, 2.f, 1.f, 0.f, 0.f }, { -2.f, 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 0.f, 1.f },
+			{ 12.f, 5.f, 1.f, 0.f, 0.f }, { 10.f, 7.f, 0.f, 1.f, 0.f }, { 10.f, 5.f, 0.f, 0.f, 1.f },
+			{ 0.f, 2.f, 1.f, 1.f, 1.f }, { -2.f, 0.f, 1.f, 1.f, 1.f }, { -2.f, 0.f, 1.f, 1.f, 1.f }, { 0.f, 2.f, 1.f, 1.f, 1.f },
+			{ 12.f, 5.f, 1.f, 1.f, 1.f }, { 10.f, 7.f, 1.f, 1.f, 1.f }, { 10.f, 7.f, 1.f, 1.f, 1.f }, { 12.f, 5.f, 1.f, 1.f, 1.f }
+		};
+		constexpr size_t EXPECTED_COUNT = sizeof( expected ) / sizeof( expected[ 0 ] );
+
+		std::vector< Vertex > out;
+		batch.transform( instances, out );
+		if ( out.size() != EXPECTED_COUNT )
+		{
+			GAME_LOG( game::LOG_ERROR, "Transform made %d vertices instead of %d", ( int )out.size(), ( int )EXPECTED_COUNT );
+			return false;
+		}
+		for ( size_t i = 0; i < EXPECTED_COUNT; ++i )
+		{
+			Vertex const &a = out[ i ];
+			Vertex const &b = expected[ i ];
+			if ( std::fabs( a.x - b.x ) > EPS || std::fabs( a.y - b.y ) > EPS || a.r != b.r || a.g != b.g || a.b != b.b )
+			{
+				GAME_LOG( game::LOG_ERROR, "Transform vertex %d is ( %f, %f ) instead of ( %f, %f )", ( int )i, a.x, a.y, b.x, b.y );
+				return false;
+			}
+		}
+		return true;
+	}
+}
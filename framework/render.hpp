@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+
+//-------------------------------------------------------
+//	instanced drawing of static geometry, engine only
+//-------------------------------------------------------
+
+namespace render
+{
+	struct Vertex
+	{
+		float x, y;
+		float r, g, b;
+	};
+
+
+	struct Instance
+	{
+		float x, y, angle;
+	};
+
+
+	// geometry of a mesh type as it is authored, triangles and a single outline loop
+	struct GeometryDesc
+	{
+		Vertex const *triangles;
+		int triangleCount;
+		Vertex const *outline;
+		int outlineCount;
+		float rotation;
+		float scale;
+		float lineWidth;
+	};
+
+
+	enum class Mode
+	{
+		Auto,		// instanced draw if the driver supports it, cpu otherwise
+		Cpu			// reference path, transforms on cpu and draws client arrays
+	};
+
+
+	// Geometry is baked once into model space lines and triangles,
+	// per frame only packed instance transforms are drawn at once.
+	class InstanceBatch
+	{
+	public:
+		explicit InstanceBatch( GeometryDesc const &desc );
+
+		void draw( std::vector< Instance > const &instances );
+
+		// writes world space vertices of all instances: triangles first, then lines
+		void transform( std::vector< Instance > const &instances, std::vector< Vertex > &out ) const;
+
+	private:
+		void drawCpu( std::vector< Instance > const &instances );
+		void drawInstanced( std::vector< Instance > const &instances );
+		void upload();
+
+		std::vector< Vertex > triangles;
+		std::vector< Vertex > lines;
+		float lineWidth;
+
+		std::vector< Vertex > transformed;
+
+		unsigned int geometryBuffer = 0;
+		unsigned int instanceBuffer = 0;
+	};
+
+
+	void setMode( Mode mode );
+	bool isInstancingActive();
+
+	// headless, needs no gl context: compares transform() of a few instances with vertices worked out by hand
+	bool checkTransform();
+}
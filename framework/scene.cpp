@@ -3,17 +3,356 @@
 #include <GL/gl.h>
 
 #include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstring>
 #include <vector>
+#include <deque>
 #include <algorithm>
 #include <random>
 
 #include "scene.hpp"
+#include "render.hpp"
+#include "triple_buffer.hpp"
 
 
 namespace scene
 {
 	constexpr float VIEW_WIDTH = 18.f;
 	constexpr float VIEW_HEIGHT = 13.5f;
+	constexpr float MIN_ZOOM = 0.25f;
+	constexpr float MAX_ZOOM = 4.f;
+
+	// world is split into square chunks, only chunks around the view are drawn and updated
+	constexpr float CHUNK_SIZE = 4.f;
+	constexpr float MAX_MESH_RADIUS = 0.5f;
+	// empty chunks keep their storage this far around the view, so meshes circling
+	// at the edge of the updated area do not reallocate chunks over and over
+	constexpr float RELEASE_MARGIN = 3.f * CHUNK_SIZE;
+}
+
+
+//-------------------------------------------------------
+//	camera
+//-------------------------------------------------------
+
+namespace
+{
+	struct Rect
+	{
+		float left, bottom, right, top;
+	};
+
+
+	struct
+	{
+		float targetX = 0.f;
+		float targetY = 0.f;
+		float panX = 0.f;
+		float panY = 0.f;
+		float zoom = 1.f;
+	} camera;
+
+
+	float cameraX()
+	{
+		return camera.targetX + camera.panX;
+	}
+
+
+	float cameraY()
+	{
+		return camera.targetY + camera.panY;
+	}
+
+
+	Rect viewRect( float margin = 0.f )
+	{
+		const float halfWidth = 0.5f * scene::VIEW_WIDTH / camera.zoom + margin;
+		const float halfHeight = 0.5f * scene::VIEW_HEIGHT / camera.zoom + margin;
+		return Rect{ cameraX() - halfWidth, cameraY() - halfHeight, cameraX() + halfWidth, cameraY() + halfHeight };
+	}
+
+
+	bool isInRect( Rect const &rect, float x, float y )
+	{
+		return x >= rect.left && x <= rect.right && y >= rect.bottom && y <= rect.top;
+	}
+}
+
+
+//-------------------------------------------------------
+//	effects levels
+//	cosmetic work only, chosen by the engine from the frame cost
+//-------------------------------------------------------
+
+namespace
+{
+	struct Effects
+	{
+		float timeBetweenSeaParticles;
+		float timeBetweenTrailParticles;
+		int islandSegments;
+	};
+
+	const Effects EFFECTS[ scene::EFFECTS_LEVELS ] =
+	{
+		{ 0.02f, 0.1f, 24 },
+		{ 0.04f, 0.15f, 16 },
+		{ 0.08f, 0.2f, 12 },
+		{ 0.16f, 0.3f, 8 },
+	};
+
+	int effectsLevel = 0;
+
+	Effects const &effects()
+	{
+		return EFFECTS[ effectsLevel ];
+	}
+}
+
+
+//-------------------------------------------------------
+//	world chunks
+//-------------------------------------------------------
+
+namespace
+{
+	struct Color
+	{
+		float r, g, b;
+	};
+
+
+	struct Particle
+	{
+		float x;
+		float y;
+		float deathTime;
+		Color color;
+	};
+
+
+	struct Chunk
+	{
+		std::vector< Particle > particles;
+		std::vector< scene::Mesh* > meshes;
+		// orbiting meshes whose circle's box overlaps the chunk, wherever they are now
+		std::vector< scene::Mesh* > orbits;
+	};
+
+
+	typedef unsigned long long ChunkKey;
+
+
+	// Chunks live in a pool and are found by key in an open addressing table. A released chunk
+	// keeps its storage for the next one created, so a view sailing over new sea does not allocate
+	// once as many chunks were alive as it needs; references to chunks stay valid while others come and go
+	class ChunkMap
+	{
+	public:
+		// nullptr if the chunk does not exist
+		Chunk *find( ChunkKey key )
+		{
+			if ( table.empty() )
+				return nullptr;
+			const Slot &slot = table[ findSlot( key ) ];
+			return slot.index == NONE ? nullptr : &pool[ slot.index ].chunk;
+		}
+
+		// creates the chunk if it does not exist
+		Chunk &operator[]( ChunkKey key )
+		{
+			if ( ( liveCount + 1 ) * 2 > table.size() )
+				grow();
+			Slot &slot = table[ findSlot( key ) ];
+			if ( slot.index == NONE )
+			{
+				slot.key = key;
+				slot.index = take( key );
+				++liveCount;
+			}
+			return pool[ slot.index ].chunk;
+		}
+
+		// releases every chunk for which release( key, chunk ) returns true
+		template< class Func >
+		void releaseIf( Func release )
+		{
+			for ( uint32_t index = 0; index < pool.size(); ++index )
+			{
+				Entry &entry = pool[ index ];
+				if ( !entry.isAlive || !release( entry.key, static_cast< Chunk const & >( entry.chunk ) ) )
+					continue;
+				erase( entry.key );
+				entry.chunk.particles.clear();
+				entry.chunk.meshes.clear();
+				entry.chunk.orbits.clear();
+				entry.isAlive = false;
+				spare.push_back( index );
+			}
+		}
+
+	private:
+		static constexpr uint32_t NONE = ~0u;
+		static constexpr size_t MIN_POOL = 128;
+		static constexpr size_t MIN_SLOTS = 2 * MIN_POOL;
+		static constexpr size_t CHUNK_PARTICLES_RESERVE = 128;
+		static constexpr size_t CHUNK_MESHES_RESERVE = 8;
+		static constexpr size_t CHUNK_ORBITS_RESERVE = 8;
+
+		struct Slot
+		{
+			ChunkKey key;
+			uint32_t index;
+		};
+
+		struct Entry
+		{
+			Chunk chunk;
+			ChunkKey key;
+			bool isAlive;
+		};
+
+		size_t home( ChunkKey key ) const
+		{
+			return ( size_t )( ( key * 0x9E3779B97F4A7C15ull ) >> 32 ) & ( table.size() - 1 );
+		}
+
+		// slot of the key or the empty slot where it would go
+		size_t findSlot( ChunkKey key ) const
+		{
+			const size_t mask = table.size() - 1;
+			size_t slot = home( key );
+			while ( table[ slot ].index != NONE && table[ slot ].key != key )
+				slot = ( slot + 1 ) & mask;
+			return slot;
+		}
+
+		uint32_t take( ChunkKey key )
+		{
+			if ( spare.empty() )
+				addEntries( std::max( MIN_POOL, pool.size() ) );
+			const uint32_t index = spare.back();
+			spare.pop_back();
+			pool[ index ].key = key;
+			pool[ index ].isAlive = true;
+			return index;
+		}
+
+		// the pool doubles, the first batch covers a view's chunks with its margin at any zoom
+		void addEntries( size_t count )
+		{
+			spare.reserve( pool.size() + count );
+			for ( size_t i = 0; i < count; ++i )
+			{
+				spare.push_back( ( uint32_t )pool.size() );
+				pool.emplace_back();
+				// enough for sea and a few trails and meshes, chunk population then stays within capacity
+				pool.back().chunk.particles.reserve( CHUNK_PARTICLES_RESERVE );
+				pool.back().chunk.meshes.reserve( CHUNK_MESHES_RESERVE );
+				pool.back().chunk.orbits.reserve( CHUNK_ORBITS_RESERVE );
+				pool.back().isAlive = false;
+			}
+		}
+
+		// linear probing, later slots of the cluster move back into the hole unless it is before their home
+		void erase( ChunkKey key )
+		{
+			const size_t mask = table.size() - 1;
+			size_t hole = findSlot( key );
+			assert( table[ hole ].index != NONE );
+			for ( size_t next = ( hole + 1 ) & mask; table[ next ].index != NONE; next = ( next + 1 ) & mask )
+			{
+				if ( ( ( next - home( table[ next ].key ) ) & mask ) >= ( ( next - hole ) & mask ) )
+				{
+					table[ hole ] = table[ next ];
+					hole = next;
+				}
+			}
+			table[ hole ].index = NONE;
+			--liveCount;
+		}
+
+		// at most half of the slots are used, so probes stay short
+		void grow()
+		{
+			table.assign( std::max( MIN_SLOTS, table.size() * 2 ), Slot{ 0, NONE } );
+			for ( uint32_t index = 0; index < pool.size(); ++index )
+			{
+				if ( pool[ index ].isAlive )
+					table[ findSlot( pool[ index ].key ) ] = Slot{ pool[ index ].key, index };
+			}
+		}
+
+		std::vector< Slot > table;
+		size_t liveCount = 0;
+		std::deque< Entry > pool;
+		std::vector< uint32_t > spare;
+	};
+
+
+	ChunkMap chunks;
+	float sceneTime = 0.f;
+
+
+	int chunkCoord( float value )
+	{
+		return ( int )std::floor( value / scene::CHUNK_SIZE );
+	}
+
+
+	ChunkKey chunkKey( int x, int y )
+	{
+		return ( ( ChunkKey )( unsigned int )x << 32 ) | ( unsigned int )y;
+	}
+
+
+	ChunkKey chunkKeyAt( float x, float y )
+	{
+		return chunkKey( chunkCoord( x ), chunkCoord( y ) );
+	}
+
+
+	// calls func( chunk ) for every existing chunk intersecting rect
+	template< class Func >
+	void forEachChunkIn( Rect const &rect, Func func )
+	{
+		const int left = chunkCoord( rect.left );
+		const int right = chunkCoord( rect.right );
+		const int bottom = chunkCoord( rect.bottom );
+		const int top = chunkCoord( rect.top );
+		for ( int y = bottom; y <= top; ++y )
+		{
+			for ( int x = left; x <= right; ++x )
+			{
+				Chunk *chunk = chunks.find( chunkKey( x, y ) );
+				if ( !chunk )
+					continue;
+				// func may add particles to other chunks, references stay valid
+				func( *chunk );
+			}
+		}
+	}
+
+
+	// empty chunks inside rect stay, so chunks around the view are not released every time
+	// their last particle dies, only chunks left behind are
+	void releaseChunksOutside( Rect const &rect )
+	{
+		const int left = chunkCoord( rect.left );
+		const int right = chunkCoord( rect.right );
+		const int bottom = chunkCoord( rect.bottom );
+		const int top = chunkCoord( rect.top );
+		chunks.releaseIf( [ left, right, bottom, top ]( ChunkKey key, Chunk const &chunk )
+		{
+			const int x = ( int )( unsigned int )( key >> 32 );
+			const int y = ( int )( unsigned int )( key & 0xFFFFFFFF );
+			const bool inside = x >= left && x <= right && y >= bottom && y <= top;
+			return !inside && chunk.meshes.empty() && chunk.orbits.empty() &&
+				std::none_of( chunk.particles.begin(), chunk.particles.end(), []( Particle const &particle ){ return particle.deathTime > sceneTime; } );
+		} );
+	}
 }
 
 
@@ -21,129 +360,995 @@ namespace scene
 //	simple particles support
 //-------------------------------------------------------
 
-namespace
-{
-	struct Color
+namespace
+{
+	void updateParticles( Chunk &chunk )
+	{
+		auto newEnd = std::remove_if( chunk.particles.begin(), chunk.particles.end(), []( Particle &particle ){ return particle.deathTime <= sceneTime; } );
+		chunk.particles.erase( newEnd, chunk.particles.end() );
+	}
+
+
+	// particles store their death time, so chunks which are not updated age them for free;
+	// a full chunk drops its dead particles first and then the new one, particles are cosmetic
+	void addParticle( float x, float y, float life, Color color )
+	{
+		Particle particle = { x, y, sceneTime + life, color };
+		Chunk &chunk = chunks[ chunkKeyAt( x, y ) ];
+		if ( chunk.particles.size() == chunk.particles.capacity() )
+		{
+			updateParticles( chunk );
+			if ( chunk.particles.size() == chunk.particles.capacity() )
+				return;
+		}
+		chunk.particles.push_back( particle );
+	}
+
+
+	void drawParticles( std::vector< Particle > const &particles )
+	{
+		glLoadIdentity();
+		glPointSize( 2.f );
+		glBegin( GL_POINTS );
+		for ( Particle const &particle : particles )
+		{
+			glColor3f( particle.color.r, particle.color.g, particle.color.b );
+			glVertex2f( particle.x, particle.y );
+		}
+		glEnd();
+	}
+}
+
+
+//-------------------------------------------------------
+//	islands support
+//	static circles, there are few of them, so they are culled one by one
+//-------------------------------------------------------
+
+namespace
+{
+	struct Island
+	{
+		float x;
+		float y;
+		float radius;
+	};
+
+	std::vector< Island > islands;
+
+
+	void drawIslands( std::vector< Island > const &visible, int segments )
+	{
+		glLoadIdentity();
+		for ( Island const &island : visible )
+		{
+			glBegin( GL_TRIANGLE_FAN );
+			glColor3f( 0.55f, 0.5f, 0.3f );
+			glVertex2f( island.x, island.y );
+			glColor3f( 0.8f, 0.75f, 0.5f );
+			for ( int i = 0; i <= segments; ++i )
+			{
+				const float angle = 2.f * 3.14159265f * i / segments;
+				glVertex2f( island.x + island.radius * cosf( angle ), island.y + island.radius * sinf( angle ) );
+			}
+			glEnd();
+		}
+	}
+}
+
+
+namespace scene
+{
+	void addIsland( float x, float y, float radius )
+	{
+		islands.push_back( Island{ x, y, radius } );
+	}
+
+
+	void clearIslands()
+	{
+		islands.clear();
+	}
+}
+
+
+//-------------------------------------------------------
+//	tracers support
+//	the game owns rounds in flight and hands them over every step as a whole,
+//	they are kept in one buffer and drawn as one batch of lines
+//-------------------------------------------------------
+
+namespace
+{
+	// tail of a tracer is where the round was this long ago
+	constexpr float TRACER_TIME = 0.05f;
+	constexpr float FLASH_LIFE = 0.3f;
+
+	struct Tracer
+	{
+		float headX;
+		float headY;
+		float tailX;
+		float tailY;
+	};
+
+	std::vector< Tracer > tracers;
+
+
+	void drawTracers( std::vector< Tracer > const &visible )
+	{
+		if ( visible.empty() )
+			return;
+		glLoadIdentity();
+		glLineWidth( 1.f );
+		glBegin( GL_LINES );
+		for ( Tracer const &tracer : visible )
+		{
+			glColor3f( 1.f, 0.6f, 0.2f );
+			glVertex2f( tracer.tailX, tracer.tailY );
+			glColor3f( 1.f, 1.f, 0.6f );
+			glVertex2f( tracer.headX, tracer.headY );
+		}
+		glEnd();
+	}
+}
+
+
+namespace scene
+{
+	void submitTracers( float const *x, float const *y, float const *vx, float const *vy, size_t count )
+	{
+		tracers.resize( count );
+		for ( size_t i = 0; i < count; ++i )
+			tracers[ i ] = Tracer{ x[ i ], y[ i ], x[ i ] - vx[ i ] * TRACER_TIME, y[ i ] - vy[ i ] * TRACER_TIME };
+	}
+
+
+	void addFlash( float x, float y )
+	{
+		addParticle( x, y, FLASH_LIFE, Color{ 1.f, 0.9f, 0.4f } );
+	}
+}
+
+
+//-------------------------------------------------------
+//	HUD support
+//	text and gauges over the scene in screen space. Glyphs come from a built-in
+//	5x7 bitmap font baked into one alpha texture, the whole overlay is a single
+//	batch of textured quads. Layout is redone only when a line changes.
+//-------------------------------------------------------
+
+namespace
+{
+	// overlay space, twice the size of a font texel on a 1024 x 768 window
+	constexpr float HUD_WIDTH = 512.f;
+	constexpr float HUD_HEIGHT = 384.f;
+	constexpr float HUD_MARGIN = 4.f;
+	constexpr int STATS_LINES = 2;
+	// frame time and counters are averaged over this period, so the stats text does not change every frame
+	constexpr float STATS_PERIOD = 0.25f;
+	constexpr int BAR_GLYPHS = 10;
+
+	// ascii 32 to 95, lower case is drawn as upper case; 5 bits per row, the top row first
+	constexpr int FIRST_GLYPH = 32;
+	constexpr int GLYPHS_COUNT = 64;
+	constexpr int GLYPH_ROWS = 7;
+	constexpr uint8_t FONT[ GLYPHS_COUNT ][ GLYPH_ROWS ] =
+	{
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04 }, // space !
+		{ 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 }, { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // " #
+		{ 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // $ %
+		{ 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, { 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // & '
+		{ 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ( )
+		{ 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // * +
+		{ 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // , -
+		{ 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // . /
+		{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 0 1
+		{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // 2 3
+		{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // 4 5
+		{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // 6 7
+		{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // 8 9
+		{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // : ;
+		{ 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // < =
+		{ 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // > ?
+		{ 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, // @ A
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // B C
+		{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // D E
+		{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // F G
+		{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // H I
+		{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // J K
+		{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // L M
+		{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // N O
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // P Q
+		{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // R S
+		{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // T U
+		{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // V W
+		{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // X Y
+		{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // Z [
+		{ 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // \ ]
+		{ 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // ^ _
+	};
+
+	// glyphs are 5 x 7 texels in cells of 6 x 8, the cell after the last glyph is solid for gauges and the backdrop
+	constexpr int CELL_WIDTH = 6;
+	constexpr int CELL_HEIGHT = 8;
+	constexpr int ATLAS_COLUMNS = 16;
+	constexpr int ATLAS_WIDTH = 128;
+	constexpr int ATLAS_HEIGHT = 64;
+	constexpr int SOLID_CELL = GLYPHS_COUNT;
+	static_assert( ( SOLID_CELL / ATLAS_COLUMNS + 1 ) * CELL_HEIGHT <= ATLAS_HEIGHT, "atlas is too small" );
+
+	constexpr size_t HUD_LINES_COUNT = STATS_LINES + scene::HUD_LINES;
+	// backdrop, then glyphs and two quads of a gauge per line
+	constexpr size_t MAX_HUD_VERTICES = 4 * ( 1 + HUD_LINES_COUNT * ( scene::HUD_LINE_LENGTH + 2 ) );
+
+	struct HudVertex
+	{
+		float x, y;
+		float u, v;
+		uint8_t r, g, b, a;
+	};
+
+	struct HudLine
+	{
+		char text[ scene::HUD_LINE_LENGTH + 1 ];
+		// negative if the line has no gauge
+		float bar;
+	};
+
+	struct
+	{
+		// stats of the scene first, then the lines of the game
+		HudLine lines[ HUD_LINES_COUNT ] = {};
+		bool isVisible = true;
+		bool isDirty = true;
+		// render frames copy the vertices only when it changes
+		uint32_t version = 0;
+		std::vector< HudVertex > vertices;
+
+		float statsTime = 0.f;
+		int statsFrames = 0;
+		float frameMsSum = 0.f;
+		float frameMsMax = 0.f;
+		size_t particles = 0;
+		size_t tracers = 0;
+	} hud;
+
+
+	bool setLine( HudLine &line, char const *text, float bar )
+	{
+		if ( line.bar == bar && strncmp( line.text, text, scene::HUD_LINE_LENGTH ) == 0 )
+			return false;
+		strncpy( line.text, text, scene::HUD_LINE_LENGTH );
+		line.text[ scene::HUD_LINE_LENGTH ] = '\0';
+		line.bar = bar;
+		hud.isDirty = true;
+		return true;
+	}
+
+
+	void addQuad( int cell, float left, float top, float width, float height, uint8_t const ( &color )[ 4 ] )
+	{
+		// corners of the cell, which are texel edges and not centers: with GL_NEAREST pixels sample
+		// the texels inside, and next to the edges lie the empty column and row every glyph leaves
+		const float u = float( cell % ATLAS_COLUMNS * CELL_WIDTH ) / ATLAS_WIDTH;
+		const float v = float( cell / ATLAS_COLUMNS * CELL_HEIGHT ) / ATLAS_HEIGHT;
+		const float du = ( cell == SOLID_CELL ? 1.f : float( CELL_WIDTH ) ) / ATLAS_WIDTH;
+		const float dv = ( cell == SOLID_CELL ? 1.f : float( CELL_HEIGHT ) ) / ATLAS_HEIGHT;
+		hud.vertices.push_back( HudVertex{ left, top, u, v, color[ 0 ], color[ 1 ], color[ 2 ], color[ 3 ] } );
+		hud.vertices.push_back( HudVertex{ left + width, top, u + du, v, color[ 0 ], color[ 1 ], color[ 2 ], color[ 3 ] } );
+		hud.vertices.push_back( HudVertex{ left + width, top + height, u + du, v + dv, color[ 0 ], color[ 1 ], color[ 2 ], color[ 3 ] } );
+		hud.vertices.push_back( HudVertex{ left, top + height, u, v + dv, color[ 0 ], color[ 1 ], color[ 2 ], color[ 3 ] } );
+	}
+
+
+	void layoutHud()
+	{
+		constexpr uint8_t BACKDROP[ 4 ] = { 0, 0, 0, 128 };
+		constexpr uint8_t STATS_TEXT[ 4 ] = { 255, 220, 120, 255 };
+		constexpr uint8_t TEXT[ 4 ] = { 230, 240, 255, 255 };
+		constexpr uint8_t BAR_EMPTY[ 4 ] = { 80, 90, 110, 255 };
+		constexpr uint8_t BAR_FULL[ 4 ] = { 120, 220, 120, 255 };
+
+		if ( hud.vertices.capacity() < MAX_HUD_VERTICES )
+			hud.vertices.reserve( MAX_HUD_VERTICES );
+		hud.vertices.clear();
+		hud.isDirty = false;
+		++hud.version;
+		if ( !hud.isVisible )
+			return;
+
+		// the backdrop is sized when all lines are laid out
+		addQuad( SOLID_CELL, 0.f, 0.f, 0.f, 0.f, BACKDROP );
+		int rows = 0;
+		size_t widest = 0;
+		for ( size_t i = 0; i < HUD_LINES_COUNT; ++i )
+		{
+			HudLine const &line = hud.lines[ i ];
+			const size_t length = strlen( line.text );
+			if ( length == 0 && line.bar < 0.f )
+				continue;
+
+			const float top = HUD_MARGIN + rows++ * CELL_HEIGHT;
+			uint8_t const ( &color )[ 4 ] = i < STATS_LINES ? STATS_TEXT : TEXT;
+			for ( size_t c = 0; c < length; ++c )
+			{
+				const int code = toupper( static_cast< unsigned char >( line.text[ c ] ) );
+				if ( code == ' ' )
+					continue;
+				const int glyph = code >= FIRST_GLYPH && code < FIRST_GLYPH + GLYPHS_COUNT ? code - FIRST_GLYPH : '?' - FIRST_GLYPH;
+				addQuad( glyph, HUD_MARGIN + c * CELL_WIDTH, top, float( CELL_WIDTH ), float( CELL_HEIGHT ), color );
+			}
+
+			size_t width = length;
+			if ( line.bar >= 0.f )
+			{
+				const float left = HUD_MARGIN + ( length + 1 ) * CELL_WIDTH;
+				const float full = float( BAR_GLYPHS * CELL_WIDTH );
+				addQuad( SOLID_CELL, left, top + 1.f, full, CELL_HEIGHT - 3.f, BAR_EMPTY );
+				addQuad( SOLID_CELL, left, top + 1.f, full * std::min( line.bar, 1.f ), CELL_HEIGHT - 3.f, BAR_FULL );
+				width += 1 + BAR_GLYPHS;
+			}
+			widest = std::max( widest, width );
+		}
+
+		if ( rows == 0 )
+		{
+			hud.vertices.clear();
+			return;
+		}
+		const float right = 2.f * HUD_MARGIN + widest * CELL_WIDTH;
+		const float bottom = 2.f * HUD_MARGIN + rows * CELL_HEIGHT;
+		hud.vertices[ 1 ].x = hud.vertices[ 2 ].x = right;
+		hud.vertices[ 2 ].y = hud.vertices[ 3 ].y = bottom;
+	}
+
+
+	// made with the gl context by scene::init, deleted by scene::deinit
+	GLuint hudAtlas = 0;
+
+
+	void createHudAtlas()
+	{
+		uint8_t texels[ ATLAS_HEIGHT ][ ATLAS_WIDTH ] = {};
+		for ( int glyph = 0; glyph < GLYPHS_COUNT; ++glyph )
+		{
+			const int left = glyph % ATLAS_COLUMNS * CELL_WIDTH;
+			const int top = glyph / ATLAS_COLUMNS * CELL_HEIGHT;
+			for ( int row = 0; row < GLYPH_ROWS; ++row )
+			{
+				for ( int column = 0; column < 5; ++column )
+					texels[ top + row ][ left + column ] = ( FONT[ glyph ][ row ] >> ( 4 - column ) ) & 1 ? 255 : 0;
+			}
+		}
+		texels[ SOLID_CELL / ATLAS_COLUMNS * CELL_HEIGHT ][ SOLID_CELL % ATLAS_COLUMNS * CELL_WIDTH ] = 255;
+
+		glGenTextures( 1, &hudAtlas );
+		glBindTexture( GL_TEXTURE_2D, hudAtlas );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_ALPHA, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_ALPHA, GL_UNSIGNED_BYTE, texels );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+	}
+
+
+	// render thread only
+	void drawHud( std::vector< HudVertex > const &vertices )
+	{
+		if ( vertices.empty() )
+			return;
+
+		glMatrixMode( GL_PROJECTION );
+		glLoadIdentity();
+		glOrtho( 0.0, HUD_WIDTH, HUD_HEIGHT, 0.0, -1.0, 1.0 );
+		glMatrixMode( GL_MODELVIEW );
+		glLoadIdentity();
+
+		glEnable( GL_TEXTURE_2D );
+		glBindTexture( GL_TEXTURE_2D, hudAtlas );
+		glEnable( GL_BLEND );
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, sizeof( HudVertex ), &vertices[ 0 ].x );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( HudVertex ), &vertices[ 0 ].u );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( HudVertex ), &vertices[ 0 ].r );
+		glDrawArrays( GL_QUADS, 0, static_cast< GLsizei >( vertices.size() ) );
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
+		glDisable( GL_BLEND );
+		glDisable( GL_TEXTURE_2D );
+	}
+}
+
+
+namespace scene
+{
+	void setHudLine( int line, char const *text, float bar )
+	{
+		assert( line >= 0 && line < HUD_LINES );
+		// gauges move by whole texels, finer steps would only redo the layout
+		constexpr float BAR_TEXELS = float( BAR_GLYPHS * CELL_WIDTH );
+		if ( bar >= 0.f )
+			bar = std::floor( std::min( bar, 1.f ) * BAR_TEXELS ) / BAR_TEXELS;
+		setLine( hud.lines[ STATS_LINES + line ], text, bar );
+	}
+}
+
+
+//-------------------------------------------------------
+//	render frames
+//	simulation thread publishes immutable snapshots of visible state,
+//	render thread draws the latest one
+//-------------------------------------------------------
+
+namespace
+{
+	struct RenderFrame
+	{
+		float cameraX;
+		float cameraY;
+		float zoom;
+		std::vector< Particle > particles;
+		std::vector< render::Instance > ships;
+		std::vector< render::Instance > aircrafts;
+		std::vector< Island > islands;
+		int islandSegments;
+		std::vector< Tracer > tracers;
+		std::vector< HudVertex > hud;
+		uint32_t hudVersion;
+		float goalMarkerX;
+		float goalMarkerY;
+		uint32_t inputSequence;
+	};
+
+
+	TripleBuffer< RenderFrame > frames;
+}
+
+
+//-------------------------------------------------------
+//	user interface: common mesh support
+//-------------------------------------------------------
+
+namespace scene
+{
+	class Mesh
+	{
+	public:
+		float positionX = 0.f;
+		float positionY = 0.f;
+		float angle = 0.f;
+		ChunkKey chunk = chunkKey( 0, 0 );
+		// bounding circle for queries, no more than MAX_MESH_RADIUS
+		float radius = MAX_MESH_RADIUS;
+		MeshKind kind = MESH_ANY;
+		void *owner = nullptr;
+
+		struct Orbit
+		{
+			float centerX;
+			float centerY;
+			float radius;
+			float startPhase;
+			float rate;
+			// game runs ahead of the scene within a frame, the clock starts at the next scene update
+			bool started;
+			float startTime;
+		};
+		bool isOrbiting = false;
+		Orbit orbit;
+		// position in orbitingMeshes
+		size_t orbitIndex = 0;
+		// query in which the mesh was reported last, an orbit listed in several chunks is reported once
+		uint32_t queryPass = 0;
+
+		// attached meshes follow their parent, x along its heading and y to its left
+		Mesh *parent = nullptr;
+		float localX = 0.f;
+		float localY = 0.f;
+		float localAngle = 0.f;
+		bool isLocalDirty = false;
+		int depth = 0;
+		int childrenCount = 0;
+		// transform pass in which the world pose changed last
+		uint32_t movedPass = 0;
+
+		virtual ~Mesh();
+		virtual void submit( RenderFrame &frame ) const;
+		virtual void update( float dt );
+
+		// memory of destroyed meshes is kept for the next ones of the same class,
+		// so aircrafts taking off and landing do not allocate once as many flew at once
+		static void *operator new( size_t size );
+		static void operator delete( void *memory, size_t size );
+
+		static std::vector< Mesh* > meshes;
+		static std::vector< Mesh* > orbitingMeshes;
+		// parents go before their children
+		static std::vector< Mesh* > attachedMeshes;
+		static bool isDepthDirty;
+		static uint32_t transformPass;
+	};
+
+
+	//-------------------------------------------------------
+	std::vector< Mesh* > Mesh::meshes;
+	std::vector< Mesh* > Mesh::orbitingMeshes;
+	std::vector< Mesh* > Mesh::attachedMeshes;
+	bool Mesh::isDepthDirty = false;
+	uint32_t Mesh::transformPass = 1;
+
+
+	namespace
+	{
+		// there are a few mesh classes, each has its own size
+		struct FreeMeshes
+		{
+			size_t size;
+			std::vector< void* > blocks;
+		};
+
+		std::vector< FreeMeshes > freeMeshes;
+	}
+
+
+	//-------------------------------------------------------
+	void *Mesh::operator new( size_t size )
+	{
+		for ( FreeMeshes &free : freeMeshes )
+		{
+			if ( free.size == size && !free.blocks.empty() )
+			{
+				void *memory = free.blocks.back();
+				free.blocks.pop_back();
+				return memory;
+			}
+		}
+		return ::operator new( size );
+	}
+
+
+	//-------------------------------------------------------
+	void Mesh::operator delete( void *memory, size_t size )
+	{
+		auto free = std::find_if( freeMeshes.begin(), freeMeshes.end(), [ size ]( FreeMeshes const &free ){ return free.size == size; } );
+		if ( free == freeMeshes.end() )
+			free = freeMeshes.insert( freeMeshes.end(), FreeMeshes{ size, std::vector< void* >() } );
+		free->blocks.push_back( memory );
+	}
+
+
+	//-------------------------------------------------------
+	Mesh::~Mesh()
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void Mesh::submit( RenderFrame &frame ) const
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void Mesh::update( float dt )
 	{
-		float r, g, b;
-	};
+	}
 
 
-	struct Particle
+	//-------------------------------------------------------
+	void addToChunk( Mesh *mesh )
 	{
-		float x;
-		float y;
-		float life;
-		Color color;
-	};
+		chunks[ mesh->chunk ].meshes.push_back( mesh );
+	}
 
 
-	std::vector< Particle > particles;
+	//-------------------------------------------------------
+	template< class MeshClass >
+	Mesh *createMesh( MeshKind kind, float radius )
+	{
+		assert( radius <= MAX_MESH_RADIUS );
+		Mesh *mesh = new MeshClass;
+		mesh->kind = kind;
+		mesh->radius = radius;
+		Mesh::meshes.push_back( mesh );
+		addToChunk( mesh );
+		return mesh;
+	}
 
 
-	void addParticle( float x, float y, float life, Color color )
+	//-------------------------------------------------------
+	void removeFromChunk( Mesh *mesh )
 	{
-		Particle particle = { x, y, life, color };
-		particles.push_back( particle );
+		std::vector< Mesh* > &chunkMeshes = chunks[ mesh->chunk ].meshes;
+		auto it = std::find( chunkMeshes.begin(), chunkMeshes.end(), mesh );
+		assert( it != chunkMeshes.end() );
+		*it = chunkMeshes.back();
+		chunkMeshes.pop_back();
 	}
 
 
-	void updateParticles( float dt )
+	//-------------------------------------------------------
+	// calls func( key ) for every chunk intersecting the box of the orbit circle, existing or not
+	template< class Func >
+	void forEachOrbitChunk( Mesh::Orbit const &orbit, Func func )
 	{
-		for ( Particle &particle : particles )
-			particle.life -= dt;
-		auto newEnd = std::remove_if( particles.begin(), particles.end(), []( Particle &particle ){ return particle.life <= 0.f; } );
-		particles.erase( newEnd, particles.end() );
+		const int left = chunkCoord( orbit.centerX - orbit.radius );
+		const int right = chunkCoord( orbit.centerX + orbit.radius );
+		const int bottom = chunkCoord( orbit.centerY - orbit.radius );
+		const int top = chunkCoord( orbit.centerY + orbit.radius );
+		for ( int y = bottom; y <= top; ++y )
+		{
+			for ( int x = left; x <= right; ++x )
+				func( chunkKey( x, y ) );
+		}
 	}
 
 
-	void drawParticles()
+	//-------------------------------------------------------
+	void addOrbitToChunks( Mesh *mesh )
 	{
-		glLoadIdentity();
-		glPointSize( 2.f );
-		glBegin( GL_POINTS );
-		for ( Particle const &particle : particles )
+		forEachOrbitChunk( mesh->orbit, [ mesh ]( ChunkKey key )
 		{
-			glColor3f( particle.color.r, particle.color.g, particle.color.b );
-			glVertex2f( particle.x, particle.y );
+			chunks[ key ].orbits.push_back( mesh );
+		} );
+	}
+
+
+	//-------------------------------------------------------
+	void removeOrbitFromChunks( Mesh *mesh )
+	{
+		forEachOrbitChunk( mesh->orbit, [ mesh ]( ChunkKey key )
+		{
+			std::vector< Mesh* > &orbits = chunks[ key ].orbits;
+			auto it = std::find( orbits.begin(), orbits.end(), mesh );
+			assert( it != orbits.end() );
+			*it = orbits.back();
+			orbits.pop_back();
+		} );
+	}
+
+
+	//-------------------------------------------------------
+	void stopOrbit( Mesh *mesh )
+	{
+		if ( !mesh->isOrbiting )
+			return;
+		removeOrbitFromChunks( mesh );
+		Mesh *last = Mesh::orbitingMeshes.back();
+		Mesh::orbitingMeshes[ mesh->orbitIndex ] = last;
+		last->orbitIndex = mesh->orbitIndex;
+		Mesh::orbitingMeshes.pop_back();
+		mesh->isOrbiting = false;
+	}
+
+
+	//-------------------------------------------------------
+	void destroyMesh( Mesh *mesh )
+	{
+		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
+		assert( it != Mesh::meshes.end() );
+		Mesh::meshes.erase( it );
+		// children stay where they are
+		for ( size_t i = Mesh::attachedMeshes.size(); mesh->childrenCount > 0 && i-- > 0; )
+		{
+			if ( Mesh::attachedMeshes[ i ]->parent == mesh )
+				detachMesh( Mesh::attachedMeshes[ i ] );
 		}
-		glEnd();
+		detachMesh( mesh );
+		stopOrbit( mesh );
+		removeFromChunk( mesh );
+		delete mesh;
+	}
+
+
+	//-------------------------------------------------------
+	void moveMesh( Mesh *mesh, float x, float y, float angle )
+	{
+		if ( mesh->positionX != x || mesh->positionY != y || mesh->angle != angle )
+			mesh->movedPass = Mesh::transformPass;
+		mesh->positionX = x;
+		mesh->positionY = y;
+		mesh->angle = angle;
+
+		const ChunkKey chunk = chunkKeyAt( x, y );
+		if ( chunk != mesh->chunk )
+		{
+			removeFromChunk( mesh );
+			mesh->chunk = chunk;
+			addToChunk( mesh );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	{
+		detachMesh( mesh );
+		stopOrbit( mesh );
+		moveMesh( mesh, x, y, angle );
+	}
+
+
+	//-------------------------------------------------------
+	void orbitMesh( Mesh *mesh, float centerX, float centerY, float radius, float phase, float rate )
+	{
+		detachMesh( mesh );
+		if ( mesh->isOrbiting )
+		{
+			removeOrbitFromChunks( mesh );
+		}
+		else
+		{
+			mesh->orbitIndex = Mesh::orbitingMeshes.size();
+			Mesh::orbitingMeshes.push_back( mesh );
+		}
+		mesh->isOrbiting = true;
+		mesh->orbit = Mesh::Orbit{ centerX, centerY, radius, phase, rate, false, 0.f };
+		addOrbitToChunks( mesh );
+	}
+
+
+	//-------------------------------------------------------
+	bool isOrbitOutside( Mesh::Orbit const &orbit, Rect const &rect )
+	{
+		return orbit.centerX + orbit.radius < rect.left || orbit.centerX - orbit.radius > rect.right ||
+			orbit.centerY + orbit.radius < rect.bottom || orbit.centerY - orbit.radius > rect.top;
+	}
+
+
+	//-------------------------------------------------------
+	float orbitPhase( Mesh::Orbit const &orbit )
+	{
+		return orbit.started ? orbit.startPhase + orbit.rate * ( sceneTime - orbit.startTime ) : orbit.startPhase;
+	}
+
+
+	//-------------------------------------------------------
+	// orbits are closed form, meshes away from the view are skipped and catch up when it returns
+	void updateOrbits()
+	{
+		const Rect active = viewRect( CHUNK_SIZE );
+		for ( Mesh *mesh : Mesh::orbitingMeshes )
+		{
+			Mesh::Orbit &orbit = mesh->orbit;
+			if ( !orbit.started )
+			{
+				orbit.started = true;
+				orbit.startTime = sceneTime;
+			}
+			if ( isOrbitOutside( orbit, active ) )
+				continue;
+
+			const float phase = orbitPhase( orbit );
+			const float heading = phase + ( orbit.rate > 0.f ? 0.5f : -0.5f ) * 3.14159265f;
+			moveMesh( mesh, orbit.centerX + orbit.radius * std::cos( phase ), orbit.centerY + orbit.radius * std::sin( phase ), heading );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void setMeshOwner( Mesh *mesh, void *owner )
+	{
+		mesh->owner = owner;
+	}
+
+
+	//-------------------------------------------------------
+	void *getMeshOwner( Mesh const *mesh )
+	{
+		return mesh->owner;
 	}
 }
 
 
 //-------------------------------------------------------
-//	user interface: common mesh support
+//	user interface: transform hierarchy
+//	attached meshes are kept in one array sorted by depth, so a single pass
+//	resolves world poses top down. A mesh is recomputed only if its local pose
+//	was changed or its parent moved in this pass, subtrees at rest are skipped.
 //-------------------------------------------------------
 
 namespace scene
 {
-	class Mesh
+	//-------------------------------------------------------
+	void placeAttached( Mesh *mesh )
 	{
-	public:
-		float positionX = 0.f;
-		float positionY = 0.f;
-		float angle = 0.f;
+		Mesh const *parent = mesh->parent;
+		const float cosAngle = std::cos( parent->angle );
+		const float sinAngle = std::sin( parent->angle );
+		moveMesh( mesh,
+				  parent->positionX + mesh->localX * cosAngle - mesh->localY * sinAngle,
+				  parent->positionY + mesh->localX * sinAngle + mesh->localY * cosAngle,
+				  parent->angle + mesh->localAngle );
+	}
 
-		virtual ~Mesh();
-		virtual void draw();
-		virtual void update( float dt );
 
-		static std::vector< Mesh* > meshes;
-	};
+	//-------------------------------------------------------
+	void attachMesh( Mesh *mesh, Mesh *parent, float localX, float localY, float localAngle )
+	{
+		detachMesh( mesh );
+		if ( !parent )
+			return;
+		for ( Mesh const *ancestor = parent; ancestor; ancestor = ancestor->parent )
+			assert( ancestor != mesh );
+
+		stopOrbit( mesh );
+		mesh->parent = parent;
+		++parent->childrenCount;
+		mesh->localX = localX;
+		mesh->localY = localY;
+		mesh->localAngle = localAngle;
+		mesh->isLocalDirty = false;
+		Mesh::attachedMeshes.push_back( mesh );
+		Mesh::isDepthDirty = true;
+		placeAttached( mesh );
+	}
 
 
 	//-------------------------------------------------------
-	std::vector< Mesh* > Mesh::meshes;
+	void detachMesh( Mesh *mesh )
+	{
+		if ( !mesh->parent )
+			return;
+		auto it = std::find( Mesh::attachedMeshes.begin(), Mesh::attachedMeshes.end(), mesh );
+		assert( it != Mesh::attachedMeshes.end() );
+		Mesh::attachedMeshes.erase( it );
+		--mesh->parent->childrenCount;
+		mesh->parent = nullptr;
+		mesh->depth = 0;
+		if ( mesh->childrenCount > 0 )
+			Mesh::isDepthDirty = true;
+	}
 
 
 	//-------------------------------------------------------
-	Mesh::~Mesh()
+	void placeMeshLocal( Mesh *mesh, float localX, float localY, float localAngle )
 	{
+		assert( mesh->parent );
+		mesh->localX = localX;
+		mesh->localY = localY;
+		mesh->localAngle = localAngle;
+		mesh->isLocalDirty = true;
 	}
 
 
 	//-------------------------------------------------------
-	void Mesh::draw()
+	// after everything placed by the game and the orbits have moved
+	void resolveTransforms()
 	{
-		glLoadIdentity();
-		glTranslatef( positionX, positionY, 0.f );
-		glRotatef( angle * 180.f / 3.14159265f, 0.f, 0.f, 1.f );
+		std::vector< Mesh* > &attached = Mesh::attachedMeshes;
+		if ( Mesh::isDepthDirty )
+		{
+			for ( Mesh *mesh : attached )
+			{
+				mesh->depth = 0;
+				for ( Mesh const *ancestor = mesh->parent; ancestor; ancestor = ancestor->parent )
+					++mesh->depth;
+			}
+			std::sort( attached.begin(), attached.end(), []( Mesh const *left, Mesh const *right )
+			{
+				return left->depth < right->depth;
+			} );
+			Mesh::isDepthDirty = false;
+		}
+
+		for ( Mesh *mesh : attached )
+		{
+			if ( mesh->isLocalDirty || mesh->parent->movedPass == Mesh::transformPass )
+			{
+				mesh->isLocalDirty = false;
+				placeAttached( mesh );
+			}
+		}
+		++Mesh::transformPass;
 	}
+}
 
 
-	//-------------------------------------------------------
-	void Mesh::update( float dt )
+//-------------------------------------------------------
+//	user interface: spatial queries
+//	chunks already index meshes by position, a mesh is in the chunk of its center,
+//	so the searched area is grown by MAX_MESH_RADIUS. Meshes circling away from the view
+//	sit in stale chunks, they are found by the chunks their orbit spans instead and
+//	tested at their closed form position.
+//-------------------------------------------------------
+
+namespace
+{
+	struct Circle
+	{
+		float x;
+		float y;
+		float radius;
+	};
+
+
+	uint32_t queryPass = 0;
+
+
+	// func gets every mesh of the kinds and its current position, meshes whose bounds
+	// can not touch the area are skipped by chunks or by orbit circles
+	template< class Func >
+	void forEachMeshNear( Rect const &area, int kinds, Func func )
+	{
+		const Rect grown = { area.left - scene::MAX_MESH_RADIUS, area.bottom - scene::MAX_MESH_RADIUS,
+							 area.right + scene::MAX_MESH_RADIUS, area.top + scene::MAX_MESH_RADIUS };
+		++queryPass;
+		forEachChunkIn( grown, [ kinds, &func, &grown ]( Chunk &chunk )
+		{
+			for ( scene::Mesh *mesh : chunk.meshes )
+			{
+				if ( ( mesh->kind & kinds ) && !mesh->isOrbiting )
+					func( mesh, Circle{ mesh->positionX, mesh->positionY, mesh->radius } );
+			}
+
+			for ( scene::Mesh *mesh : chunk.orbits )
+			{
+				scene::Mesh::Orbit const &orbit = mesh->orbit;
+				if ( !( mesh->kind & kinds ) || mesh->queryPass == queryPass || scene::isOrbitOutside( orbit, grown ) )
+					continue;
+				mesh->queryPass = queryPass;
+				const float phase = scene::orbitPhase( orbit );
+				func( mesh, Circle{ orbit.centerX + orbit.radius * std::cos( phase ), orbit.centerY + orbit.radius * std::sin( phase ), mesh->radius } );
+			}
+		} );
+	}
+
+
+	bool touchesRect( Circle const &circle, Rect const &rect )
 	{
+		const float dx = circle.x - std::max( rect.left, std::min( circle.x, rect.right ) );
+		const float dy = circle.y - std::max( rect.bottom, std::min( circle.y, rect.top ) );
+		return dx * dx + dy * dy <= circle.radius * circle.radius;
 	}
+}
 
 
+namespace scene
+{
 	//-------------------------------------------------------
-	template< class MeshClass >
-	Mesh *createMesh()
+	Mesh *pick( float x, float y, int kinds )
 	{
-		Mesh *mesh = new MeshClass;
-		Mesh::meshes.push_back( mesh );
-		return mesh;
+		Mesh *picked = nullptr;
+		float pickedDistance = 0.f;
+		forEachMeshNear( Rect{ x, y, x, y }, kinds, [ x, y, &picked, &pickedDistance ]( Mesh *mesh, Circle const &bounds )
+		{
+			const float distance = std::hypot( bounds.x - x, bounds.y - y );
+			if ( distance <= bounds.radius && ( !picked || distance < pickedDistance ) )
+			{
+				picked = mesh;
+				pickedDistance = distance;
+			}
+		} );
+		return picked;
 	}
 
 
 	//-------------------------------------------------------
-	void destroyMesh( Mesh *mesh )
+	void queryRect( float left, float bottom, float right, float top, std::vector< Mesh* > &result, int kinds )
 	{
-		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
-		assert( it != Mesh::meshes.end() );
-		Mesh::meshes.erase( it );
-		delete mesh;
+		const Rect area = { std::min( left, right ), std::min( bottom, top ), std::max( left, right ), std::max( bottom, top ) };
+		forEachMeshNear( area, kinds, [ &area, &result ]( Mesh *mesh, Circle const &bounds )
+		{
+			if ( touchesRect( bounds, area ) )
+				result.push_back( mesh );
+		} );
 	}
 
 
 	//-------------------------------------------------------
-	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	void queryRadius( float x, float y, float radius, std::vector< Mesh* > &result, int kinds )
 	{
-		mesh->positionX = x;
-		mesh->positionY = y;
-		mesh->angle = angle;
+		forEachMeshNear( Rect{ x - radius, y - radius, x + radius, y + radius }, kinds, [ x, y, radius, &result ]( Mesh *mesh, Circle const &bounds )
+		{
+			if ( std::hypot( bounds.x - x, bounds.y - y ) <= radius + bounds.radius )
+				result.push_back( mesh );
+		} );
 	}
 }
 
@@ -157,49 +1362,50 @@ namespace
 	class ShipMesh : public scene::Mesh
 	{
 	public:
-		void draw() override;
+		void submit( RenderFrame &frame ) const override;
 	};
 
 
 	//-------------------------------------------------------
-	void ShipMesh::draw()
+	const render::Vertex SHIP_TRIANGLES[] =
 	{
-		Mesh::draw();
+		{ -0.1f, -0.4f, 0.1f, 0.3f, 0.6f },
+		{ 0.1f, -0.4f, 0.1f, 0.3f, 0.6f },
+		{ 0.1f, 0.4f, 0.1f, 0.3f, 0.6f },
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
-		glScalef( 0.8f, 0.8f, 0.8f );
+		{ -0.1f, 0.4f, 0.1f, 0.3f, 0.6f },
+		{ 0.1f, 0.4f, 0.1f, 0.3f, 0.6f },
+		{ -0.1f, -0.4f, 0.1f, 0.3f, 0.6f },
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.1f, 0.3f, 0.6f );
+		{ -0.1f, -0.4f, 0.1f, 0.3f, 0.6f },
+		{ -0.1f, 0.4f, 0.1f, 0.3f, 0.6f },
+		{ -0.15f, -0.1f, 0.1f, 0.3f, 0.6f },
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
-
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, -0.4f );
+		{ 0.1f, -0.4f, 0.1f, 0.3f, 0.6f },
+		{ 0.1f, 0.4f, 0.1f, 0.3f, 0.6f },
+		{ 0.15f, -0.1f, 0.1f, 0.3f, 0.6f },
+	};
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
+	const render::Vertex SHIP_OUTLINE[] =
+	{
+		{ -0.1f, -0.4f, 0.4f, 0.8f, 1.f },
+		{ 0.1f, -0.4f, 0.4f, 0.8f, 1.f },
+		{ 0.15f, -0.1f, 0.4f, 0.8f, 1.f },
+		{ 0.1f, 0.4f, 0.4f, 0.8f, 1.f },
+		{ -0.1f, 0.4f, 0.4f, 0.8f, 1.f },
+		{ -0.15f, -0.1f, 0.4f, 0.8f, 1.f },
+	};
 
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( 0.15f, -0.1f );
+	render::InstanceBatch shipBatch( render::GeometryDesc{
+		SHIP_TRIANGLES, sizeof( SHIP_TRIANGLES ) / sizeof( SHIP_TRIANGLES[ 0 ] ),
+		SHIP_OUTLINE, sizeof( SHIP_OUTLINE ) / sizeof( SHIP_OUTLINE[ 0 ] ),
+		-0.5f * 3.14159265f, 0.8f, 2.f } );
 
-		glEnd();
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.4f, 0.8f, 1.f );
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.15f, -0.1f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
-		glEnd();
+	//-------------------------------------------------------
+	void ShipMesh::submit( RenderFrame &frame ) const
+	{
+		frame.ships.push_back( render::Instance{ positionX, positionY, angle } );
 	}
 }
 
@@ -209,7 +1415,7 @@ namespace scene
 	//-------------------------------------------------------
 	Mesh *createShipMesh()
 	{
-		return createMesh< ShipMesh >();
+		return createMesh< ShipMesh >( MESH_SHIP, 0.42f );
 	}
 }
 
@@ -223,7 +1429,7 @@ namespace
 	class AircraftMesh : public scene::Mesh
 	{
 	public:
-		void draw() override;
+		void submit( RenderFrame &frame ) const override;
 		void update( float dt ) override;
 
 	private:
@@ -232,31 +1438,35 @@ namespace
 
 
 	//-------------------------------------------------------
-	void AircraftMesh::draw()
+	const render::Vertex AIRCRAFT_TRIANGLES[] =
+	{
+		{ -0.06f, -0.1f, 0.5f, 0.6f, 0.1f },
+		{ 0.06f, -0.1f, 0.5f, 0.6f, 0.1f },
+		{ 0.f, 0.1f, 0.5f, 0.6f, 0.1f },
+		{ -0.1f, -0.1f, 0.5f, 0.6f, 0.1f },
+		{ 0.1f, -0.1f, 0.5f, 0.6f, 0.1f },
+		{ 0.f, 0.0f, 0.5f, 0.6f, 0.1f },
+	};
+
+	const render::Vertex AIRCRAFT_OUTLINE[] =
 	{
-		Mesh::draw();
+		{ -0.1f, -0.1f, 0.8f, 1.f, 0.2f },
+		{ 0.1f, -0.1f, 0.8f, 1.f, 0.2f },
+		{ 0.04f, -0.04f, 0.8f, 1.f, 0.2f },
+		{ 0.f, 0.1f, 0.8f, 1.f, 0.2f },
+		{ -0.04f, -0.04f, 0.8f, 1.f, 0.2f },
+	};
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
+	render::InstanceBatch aircraftBatch( render::GeometryDesc{
+		AIRCRAFT_TRIANGLES, sizeof( AIRCRAFT_TRIANGLES ) / sizeof( AIRCRAFT_TRIANGLES[ 0 ] ),
+		AIRCRAFT_OUTLINE, sizeof( AIRCRAFT_OUTLINE ) / sizeof( AIRCRAFT_OUTLINE[ 0 ] ),
+		-0.5f * 3.14159265f, 1.f, 2.f } );
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.5f, 0.6f, 0.1f );
-		glVertex2f( -0.06f, -0.1f );
-		glVertex2f( 0.06f, -0.1f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.f, 0.0f );
-		glEnd();
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.8f, 1.f, 0.2f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.04f, -0.04f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.04f, -0.04f );
-		glEnd();
+	//-------------------------------------------------------
+	void AircraftMesh::submit( RenderFrame &frame ) const
+	{
+		frame.aircrafts.push_back( render::Instance{ positionX, positionY, angle } );
 	}
 
 
@@ -265,7 +1475,7 @@ namespace
 		nextParticleTimeout -= dt;
 		if ( nextParticleTimeout <= 0.f )
 		{
-			nextParticleTimeout += 0.1f;
+			nextParticleTimeout += effects().timeBetweenTrailParticles;
 			addParticle( positionX, positionY, 0.8f, Color{ 1.f, 1.f, 1.f } );
 		}
 	}
@@ -276,7 +1486,7 @@ namespace scene
 	//-------------------------------------------------------
 	Mesh *createAircraftMesh()
 	{
-		return createMesh< AircraftMesh >();
+		return createMesh< AircraftMesh >( MESH_AIRCRAFT, 0.15f );
 	}
 }
 
@@ -294,16 +1504,16 @@ namespace
 	} goalMarker;
 
 
-	void drawGoalMarker()
+	void drawGoalMarker( float x, float y )
 	{
 		glLoadIdentity();
 		glLineWidth( 3.f );
 		glBegin( GL_LINES );
 		glColor3f( 1.0f, 0.3f, 0.2f );
-		glVertex2f( goalMarker.x - 0.1f, goalMarker.y - 0.1f );
-		glVertex2f( goalMarker.x + 0.1f, goalMarker.y + 0.1f );
-		glVertex2f( goalMarker.x - 0.1f, goalMarker.y + 0.1f );
-		glVertex2f( goalMarker.x + 0.1f, goalMarker.y - 0.1f );
+		glVertex2f( x - 0.1f, y - 0.1f );
+		glVertex2f( x + 0.1f, y + 0.1f );
+		glVertex2f( x - 0.1f, y + 0.1f );
+		glVertex2f( x + 0.1f, y - 0.1f );
 		glEnd();
 	}
 }
@@ -319,6 +1529,42 @@ namespace scene
 }
 
 
+//-------------------------------------------------------
+//	user interface: camera
+//-------------------------------------------------------
+
+namespace scene
+{
+	void placeCamera( float x, float y )
+	{
+		camera.targetX = x;
+		camera.targetY = y;
+	}
+
+
+	void panCamera( float dx, float dy )
+	{
+		camera.panX -= dx * VIEW_WIDTH / camera.zoom;
+		camera.panY -= dy * VIEW_HEIGHT / camera.zoom;
+	}
+
+
+	void zoomCamera( float factor )
+	{
+		camera.zoom = std::min( std::max( camera.zoom * factor, MIN_ZOOM ), MAX_ZOOM );
+	}
+
+
+	void centerCamera()
+	{
+		camera.panX = 0.f;
+		camera.panY = 0.f;
+		camera.zoom = 1.f;
+	}
+
+}
+
+
 //-------------------------------------------------------
 //	user interface: utility functions
 //-------------------------------------------------------
@@ -327,8 +1573,8 @@ namespace scene
 {
 	void screenToWorld( float *x, float *y )
 	{
-		*x = 0.5f * VIEW_WIDTH * ( 2.f * *x - 1.f );
-		*y = 0.5f * VIEW_HEIGHT * ( 2.f * *y - 1.f );
+		*x = cameraX() + 0.5f * VIEW_WIDTH / camera.zoom * ( 2.f * *x - 1.f );
+		*y = cameraY() + 0.5f * VIEW_HEIGHT / camera.zoom * ( 2.f * *y - 1.f );
 	}
 }
 
@@ -341,46 +1587,173 @@ namespace scene
 {
 	namespace
 	{
-		constexpr float TIME_BETWEEN_SEA_PARTICLES = 0.02f;
 		float timeToNextSeaParticle = 0.f;
 		std::default_random_engine seaParticlesRandomEngine( 42 );
-		std::uniform_real_distribution< float > seaParticlesHorizDistr( -0.5f * VIEW_WIDTH, 0.5f * VIEW_WIDTH );
-		std::uniform_real_distribution< float > seaParticlesVertDistr( -0.5f * VIEW_HEIGHT, 0.5f * VIEW_HEIGHT );
+		std::uniform_real_distribution< float > seaParticlesDistr( 0.f, 1.f );
+	}
+
+
+	void setEffectsLevel( int level )
+	{
+		assert( level >= 0 && level < EFFECTS_LEVELS );
+		effectsLevel = level;
 	}
 
 
 	void update( float dt )
 	{
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->update( dt );
-		updateParticles( dt );
+		sceneTime += dt;
+		updateOrbits();
+		resolveTransforms();
+
+		// chunks next to the view are kept alive too, so trails are in place when they scroll in
+		forEachChunkIn( viewRect( CHUNK_SIZE ), [ dt ]( Chunk &chunk )
+		{
+			for ( Mesh *mesh : chunk.meshes )
+				mesh->update( dt );
+			updateParticles( chunk );
+		} );
+		releaseChunksOutside( viewRect( RELEASE_MARGIN ) );
 
+		const Rect view = viewRect();
 		timeToNextSeaParticle += dt;
 		while ( timeToNextSeaParticle > 0.f )
 		{
-			timeToNextSeaParticle -= TIME_BETWEEN_SEA_PARTICLES;
-			addParticle( seaParticlesHorizDistr( seaParticlesRandomEngine ),
-						 seaParticlesVertDistr( seaParticlesRandomEngine ),
+			timeToNextSeaParticle -= effects().timeBetweenSeaParticles;
+			addParticle( view.left + ( view.right - view.left ) * seaParticlesDistr( seaParticlesRandomEngine ),
+						 view.bottom + ( view.top - view.bottom ) * seaParticlesDistr( seaParticlesRandomEngine ),
 						 3.f,
 						 Color{ 0.15f, 0.3f, 0.6f } );
 		}
 	}
 
 
-	void draw()
+	void publish( uint32_t inputSequence )
+	{
+		RenderFrame &frame = frames.back();
+		frame.inputSequence = inputSequence;
+		frame.cameraX = cameraX();
+		frame.cameraY = cameraY();
+		frame.zoom = camera.zoom;
+		frame.goalMarkerX = goalMarker.x;
+		frame.goalMarkerY = goalMarker.y;
+
+		frame.particles.clear();
+		forEachChunkIn( viewRect(), [ &frame ]( Chunk &chunk )
+		{
+			frame.particles.insert( frame.particles.end(), chunk.particles.begin(), chunk.particles.end() );
+		} );
+
+		frame.islandSegments = effects().islandSegments;
+		frame.islands.clear();
+		for ( Island const &island : islands )
+		{
+			if ( isInRect( viewRect( island.radius ), island.x, island.y ) )
+				frame.islands.push_back( island );
+		}
+
+		frame.tracers.clear();
+		const Rect view = viewRect();
+		for ( Tracer const &tracer : tracers )
+		{
+			if ( isInRect( view, tracer.headX, tracer.headY ) )
+				frame.tracers.push_back( tracer );
+		}
+
+		frame.ships.clear();
+		frame.aircrafts.clear();
+		const Rect meshView = viewRect( MAX_MESH_RADIUS );
+		forEachChunkIn( meshView, [ &meshView, &frame ]( Chunk &chunk )
+		{
+			for ( Mesh *mesh : chunk.meshes )
+			{
+				if ( isInRect( meshView, mesh->positionX, mesh->positionY ) )
+					mesh->submit( frame );
+			}
+		} );
+
+		if ( hud.isDirty )
+			layoutHud();
+		if ( frame.hudVersion != hud.version || frame.hud.capacity() < MAX_HUD_VERTICES )
+		{
+			if ( frame.hud.capacity() < MAX_HUD_VERTICES )
+				frame.hud.reserve( MAX_HUD_VERTICES );
+			frame.hud = hud.vertices;
+			frame.hudVersion = hud.version;
+		}
+		hud.particles = frame.particles.size();
+		hud.tracers = frame.tracers.size();
+
+		frames.publish();
+	}
+
+
+	void setFrameStats( float frameMs )
+	{
+		hud.frameMsSum += frameMs;
+		hud.frameMsMax = std::max( hud.frameMsMax, frameMs );
+		++hud.statsFrames;
+		if ( sceneTime - hud.statsTime < STATS_PERIOD )
+			return;
+
+		char text[ HUD_LINE_LENGTH + 1 ];
+		sprintf_s( text, "FRAME %5.2f MS  MAX %5.2f MS  FX %d", hud.frameMsSum / hud.statsFrames, hud.frameMsMax, effectsLevel );
+		setLine( hud.lines[ 0 ], text, -1.f );
+		sprintf_s( text, "MESHES %3u  PARTICLES %5u  ROUNDS %4u", static_cast< unsigned >( Mesh::meshes.size() ),
+				   static_cast< unsigned >( hud.particles ), static_cast< unsigned >( hud.tracers ) );
+		setLine( hud.lines[ 1 ], text, -1.f );
+		hud.statsTime = sceneTime;
+		hud.statsFrames = 0;
+		hud.frameMsSum = 0.f;
+		hud.frameMsMax = 0.f;
+	}
+
+
+	void toggleHud()
+	{
+		hud.isVisible = !hud.isVisible;
+		hud.isDirty = true;
+	}
+
+
+	void init()
+	{
+		createHudAtlas();
+	}
+
+
+	void deinit()
+	{
+		glDeleteTextures( 1, &hudAtlas );
+		hudAtlas = 0;
+	}
+
+
+	bool draw( uint32_t *inputSequence )
 	{
+		if ( !frames.acquire() )
+			return false;
+		RenderFrame const &frame = frames.front();
+		if ( inputSequence )
+			*inputSequence = frame.inputSequence;
+
 		glMatrixMode( GL_PROJECTION );
 		glLoadIdentity();
-		glScalef( 2.f / VIEW_WIDTH, 2.f / VIEW_HEIGHT, 0.f );
+		glScalef( 2.f * frame.zoom / VIEW_WIDTH, 2.f * frame.zoom / VIEW_HEIGHT, 0.f );
+		glTranslatef( -frame.cameraX, -frame.cameraY, 0.f );
 
 		glDisable( GL_CULL_FACE );
 		glClearColor( 0.1f, 0.2f, 0.4f, 0.f );
 		glClear( GL_COLOR_BUFFER_BIT );
 		glMatrixMode( GL_MODELVIEW );
 
-		drawParticles();
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->draw();
-		drawGoalMarker();
+		drawParticles( frame.particles );
+		drawIslands( frame.islands, frame.islandSegments );
+		shipBatch.draw( frame.ships );
+		aircraftBatch.draw( frame.aircrafts );
+		drawTracers( frame.tracers );
+		drawGoalMarker( frame.goalMarkerX, frame.goalMarkerY );
+		drawHud( frame.hud );
+		return true;
 	}
 }
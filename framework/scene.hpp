@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 //-------------------------------------------------------
 //	user interface
 //-------------------------------------------------------
@@ -8,14 +12,58 @@ namespace scene
 {
 	class Mesh;
 
+	enum MeshKind
+	{
+		MESH_SHIP = 1,
+		MESH_AIRCRAFT = 2,
+		MESH_ANY = MESH_SHIP | MESH_AIRCRAFT
+	};
+
 	Mesh *createShipMesh();
 	Mesh *createAircraftMesh();
 	void destroyMesh( Mesh *mesh );
+	// game object behind the mesh, so query results can be mapped back to it
+	void setMeshOwner( Mesh *mesh, void *owner );
+	void *getMeshOwner( Mesh const *mesh );
 	void placeMesh( Mesh *mesh, float x, float y, float angle );
+	// mesh keeps circling on its own while visible, until placed again; phase is the polar angle around the center
+	void orbitMesh( Mesh *mesh, float centerX, float centerY, float radius, float phase, float rate );
+
+	// attached mesh follows its parent until placed, orbited or detached, then it stays where it was;
+	// local x is along the parent's heading, y to its left. World poses are resolved once per scene update
+	void attachMesh( Mesh *mesh, Mesh *parent, float localX, float localY, float localAngle );
+	void detachMesh( Mesh *mesh );
+	void placeMeshLocal( Mesh *mesh, float localX, float localY, float localAngle );
 
 	void screenToWorld( float *x, float *y );
 
+	// queries test bounding circles of meshes of the given kinds in world coordinates,
+	// circling meshes are tested where they are now even if they are away from the view
+	// pick returns the mesh closest to the point among the ones covering it, nullptr if there is none
+	Mesh *pick( float x, float y, int kinds = MESH_ANY );
+	// append to result, which is not cleared
+	void queryRect( float left, float bottom, float right, float top, std::vector< Mesh* > &result, int kinds = MESH_ANY );
+	void queryRadius( float x, float y, float radius, std::vector< Mesh* > &result, int kinds = MESH_ANY );
+
 	void placeGoalMarker( float x, float y );
+
+	// islands never move, they are drawn over the sea and under the meshes
+	void addIsland( float x, float y, float radius );
+	void clearIslands();
+
+	// rounds in flight as parallel arrays, they replace the ones submitted before;
+	// drawn as short lines trailing behind each position
+	void submitTracers( float const *x, float const *y, float const *vx, float const *vy, size_t count );
+	void addFlash( float x, float y );
+
+	// text overlay in the top left corner of the window, lines keep their text until set again
+	// and empty ones are skipped; a bar in [0, 1] draws a gauge after the text, negative for none
+	constexpr int HUD_LINES = 24;
+	constexpr int HUD_LINE_LENGTH = 48;
+	void setHudLine( int line, char const *text, float bar = -1.f );
+
+	// camera follows this point, view can be panned and zoomed around it
+	void placeCamera( float x, float y );
 }
 
 
@@ -25,6 +73,25 @@ namespace scene
 
 namespace scene
 {
+	// simulation thread: update, then publish a snapshot of the visible scene
+	// which reflects input events up to inputSequence, see latency_tracker
 	void update( float dt );
-	void draw();
+	// 0 is full quality, higher levels emit fewer sea and trail particles and draw coarser islands
+	constexpr int EFFECTS_LEVELS = 4;
+	void setEffectsLevel( int level );
+	void publish( uint32_t inputSequence = 0 );
+	// frame cost for the stats lines of the HUD, averaged over a few frames
+	void setFrameStats( float frameMs );
+	void toggleHud();
+
+	// render thread, with the gl context current: resources of the scene live between these two
+	void init();
+	void deinit();
+	// render thread: draws the latest published snapshot, returns false if there is no new one
+	bool draw( uint32_t *inputSequence = nullptr );
+
+	// dx, dy are in screen fractions, same units as game::mouseClicked
+	void panCamera( float dx, float dy );
+	void zoomCamera( float factor );
+	void centerCamera();
 }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+
+//-------------------------------------------------------
+//	lock-free single producer single consumer ring buffer
+//-------------------------------------------------------
+
+template< class T, size_t CAPACITY >
+class SpscQueue
+{
+	static_assert( ( CAPACITY & ( CAPACITY - 1 ) ) == 0, "capacity must be a power of two" );
+
+public:
+	// producer only, returns false when the queue is full
+	bool push( T const &value )
+	{
+		const size_t tail = tailIndex.load( std::memory_order_relaxed );
+		if ( tail - headIndex.load( std::memory_order_acquire ) == CAPACITY )
+			return false;
+		items[ tail & ( CAPACITY - 1 ) ] = value;
+		tailIndex.store( tail + 1, std::memory_order_release );
+		return true;
+	}
+
+	// consumer only, returns false when the queue is empty
+	bool pop( T &value )
+	{
+		const size_t head = headIndex.load( std::memory_order_relaxed );
+		if ( head == tailIndex.load( std::memory_order_acquire ) )
+			return false;
+		value = items[ head & ( CAPACITY - 1 ) ];
+		headIndex.store( head + 1, std::memory_order_release );
+		return true;
+	}
+
+private:
+	alignas( 64 ) std::atomic< size_t > headIndex{ 0 };
+	alignas( 64 ) std::atomic< size_t > tailIndex{ 0 };
+	T items[ CAPACITY ];
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+
+
+//-------------------------------------------------------
+//	lock-free triple buffer, writer never waits for reader
+//-------------------------------------------------------
+
+template< class T >
+class TripleBuffer
+{
+public:
+	// writer side: fill back() then publish() it, back() is reused and holds stale data
+	T &back() { return slots[ backIndex ]; }
+
+	void publish()
+	{
+		backIndex = middleIndex.exchange( backIndex | FRESH, std::memory_order_acq_rel ) & INDEX_MASK;
+	}
+
+	// reader side: takes the latest published slot, returns false if nothing new was published
+	bool acquire()
+	{
+		if ( !( middleIndex.load( std::memory_order_relaxed ) & FRESH ) )
+			return false;
+		frontIndex = middleIndex.exchange( frontIndex, std::memory_order_acq_rel ) & INDEX_MASK;
+		return true;
+	}
+
+	T const &front() const { return slots[ frontIndex ]; }
+
+private:
+	static constexpr unsigned int FRESH = 4;
+	static constexpr unsigned int INDEX_MASK = 3;
+
+	T slots[ 3 ];
+	unsigned int backIndex = 0;
+	std::atomic< unsigned int > middleIndex{ 1 };
+	unsigned int frontIndex = 2;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "hangar.hpp"
+
+#include <tuple>
+
+
+//-------------------------------------------------------
+//	Mixed air wing, aircrafts are stored in per-model squadrons
+//	so every update loop is homogeneous and has no dispatch
+//-------------------------------------------------------
+
+template<class... FlightModels>
+class AirWing
+{
+public:
+	template<class FlightModel>
+	Squadron<FlightModel>& squadron() { return std::get<Squadron<FlightModel>>(squadrons); }
+
+	// calls func(squadron) for every squadron, func is expected to be a generic lambda
+	template<class Func>
+	void forEachSquadron(Func func)
+	{
+		using expand = int[];
+		(void)expand{ 0, (func(std::get<Squadron<FlightModels>>(squadrons)), 0)... };
+	}
+
+	// calls func(aicraft) for every aircraft, squadron by squadron
+	template<class Func>
+	void forEach(Func func)
+	{
+		forEachSquadron([&func](auto &squadron) { squadron.forEach(func); });
+	}
+
+	template<class Func>
+	void forEach(Func func) const
+	{
+		using expand = int[];
+		(void)expand{ 0, (std::get<Squadron<FlightModels>>(squadrons).forEach(func), 0)... };
+	}
+
+	// only airborne aircrafts and those whose sleep is over are resumed
+	void update(double now, float dt, const WindField &wind, DetailScheduler &detail)
+	{
+		forEachSquadron([now, dt, &wind, &detail](auto &squadron) { squadron.update(now, dt, wind, detail); });
+	}
+
+	void newTarget(Vector2 target)
+	{
+		forEachSquadron([&target](auto &squadron) { squadron.newTarget(target); });
+	}
+
+	// only the squadron of the aircraft acts, at a constant cost
+	void recall(AicraftBase *aicraft)
+	{
+		forEachSquadron([aicraft](auto &squadron) { squadron.recall(aicraft); });
+	}
+
+	// squadrons are tried in declaration order, cost does not depend on the number of aircrafts
+	bool launch()
+	{
+		bool launched = false;
+		forEachSquadron([&launched](auto &squadron)
+		{
+			if (!launched && squadron.launch())
+				launched = true;
+		});
+		return launched;
+	}
+
+	void clear()
+	{
+		forEachSquadron([](auto &squadron) { squadron.clear(); });
+	}
+
+private:
+	std::tuple<Squadron<FlightModels>...> squadrons;
+};
@@ -1,81 +1,136 @@
 #include "aircraft.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
+#include "projectiles.hpp"
 #include "ship.hpp"
+#include "state_machine.hpp"
 
 namespace
 {
-	constexpr float POS_EPS = 0.1f;
+	using steering::POS_EPS;
+
+	// arcs are split into chords not longer than this for swept tests
+	constexpr float MAX_CHORD_ANGLE = 0.2f;
+	// heading has to be this close to the tangent of the flyby circle to lock on it
+	constexpr float ORBIT_ENTRY_COS = 0.1f;
+	// aircraft is expected over the deck this long before its flight time is over
+	constexpr float RETURN_RESERVE_SEC = 1.f;
+	// loitering aircraft checks the return estimate at least this often
+	constexpr double MIN_LOITER_SLEEP_SEC = 0.1;
+
+	constexpr const char* STATE_NAMES[] =
+	{
+		"NotReady",
+		"Fueling",
+		"Ready",
+		"Takeoff",
+		"MovingToTarget",
+		"MovingToBase"
+	};
+	static_assert(sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]) == AICRAFT_STATES_COUNT, "every state needs a name");
+
+	// closest distance to the origin along a segment, used with positions relative to the ship
+	float closestApproach(Vector2 from, Vector2 to)
+	{
+		const Vector2 direction = to - from;
+		const float lengthSquared = direction.lengthSquared();
+		float t = 0.f;
+		if (lengthSquared > 0.f)
+		{
+			t = -dot(from, direction) / lengthSquared;
+			t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t);
+		}
+		return (from + t * direction).length();
+	}
 
-	const char* toString(AicraftState state)
+	// exact motion with constant speed and turn rate
+	void advanceOnArc(Vector2 &position, float &angle, float speed, float angularSpeed, float dt)
 	{
-		switch (state)
+		const float newAngle = angle + angularSpeed * dt;
+		if (fabs(angularSpeed * dt) < 1e-4f)
 		{
-		case AicraftState::NotReady:
-			return "NotReady";
-		case AicraftState::Fueling:
-			return "Fueling";
-		case AicraftState::Ready:
-			return "Ready";
-		case AicraftState::Takeoff:
-			return "Takeoff";
-		case AicraftState::MovingToTarget:
-			return "MovingToTarget";
-		case AicraftState::MovingToBase:
-			return "MovingToBase";
-		default:
-			return "Undefined";
+			position = position + speed * dt * Vector2::fromAngle(newAngle);
 		}
+		else
+		{
+			const float r = speed / angularSpeed;
+			position = position + r * Vector2(std::sin(newAngle) - std::sin(angle), std::cos(angle) - std::cos(newAngle));
+		}
+		angle = math::scopedAngle(newAngle);
 	}
 
-	float turnRadius(float speed, float angularSpeed)
+	// V of rows behind the leader, right wing first
+	Vector2 formationSlot(int index)
 	{
-		return fabs(speed / angularSpeed);
+		const float row = static_cast<float>(index / 2 + 1);
+		const float side = index % 2 == 0 ? -1.f : 1.f;
+		return params::formation::SLOT_SPACING * Vector2(-row, side * row);
 	}
+}
+
 
-	Vector2 centerOfTurn(Vector2 position, float angle, float speed, float angularSpeed)
+const char* toString(AicraftState state)
+{
+	const size_t index = static_cast<size_t>(state);
+	return index < AICRAFT_STATES_COUNT ? STATE_NAMES[index] : "Undefined";
+}
+
+
+//-------------------------------------------------------
+//	Lifecycle
+//	states change only by the transitions listed here, the sortie
+//	routine reports events and the table decides where they lead
+//-------------------------------------------------------
+
+struct AicraftLifecycle
+{
+	static bool isPastBow(const AicraftBase &aicraft)
 	{
-		const float normalAngle = angularSpeed > 0 ? angle + math::PI / 2 : angle - math::PI / 2;
-		Vector2 normal{cosf(normalAngle), sinf(normalAngle)};
-		const float r = turnRadius(speed, angularSpeed);
-		normal = r*normal;
-		const Vector2 center = position + normal;
-		return center;
+		return aicraft.shipPosition >= aicraft.ship->getDeckFront();
 	}
 
-	bool isPointInCircle(Vector2 point, Vector2 center, float r)
+	static bool isFueled(const AicraftBase &aicraft)
 	{
-		const Vector2 diff = point - center;
-		return diff.length() <= r;
+		return aicraft.ship->getTime() >= aicraft.nextStateTime;
 	}
-	
+};
+
+namespace
+{
+	typedef StateMachine<AicraftState, AICRAFT_STATES_COUNT, AicraftEvent, AICRAFT_EVENTS_COUNT, AicraftBase> Lifecycle;
+
+	constexpr Lifecycle::TransitionType TRANSITIONS[] =
+	{
+		{ AicraftState::NotReady, AicraftEvent::Prepared, AicraftState::Ready, nullptr },
+		{ AicraftState::Ready, AicraftEvent::Launched, AicraftState::Takeoff, nullptr },
+		{ AicraftState::Takeoff, AicraftEvent::LiftedOff, AicraftState::MovingToTarget, &AicraftLifecycle::isPastBow },
+		{ AicraftState::MovingToTarget, AicraftEvent::Returned, AicraftState::MovingToBase, nullptr },
+		{ AicraftState::MovingToTarget, AicraftEvent::Recalled, AicraftState::MovingToBase, nullptr },
+		{ AicraftState::MovingToBase, AicraftEvent::Landed, AicraftState::Fueling, nullptr },
+		{ AicraftState::Fueling, AicraftEvent::Fueled, AicraftState::Ready, &AicraftLifecycle::isFueled },
+	};
+
+	constexpr Lifecycle LIFECYCLE(TRANSITIONS, AicraftState::NotReady);
+	static_assert(LIFECYCLE.isWellFormed(), "a transition is listed twice or out of range");
+	static_assert(LIFECYCLE.isEveryStateReachable(), "a state can not be reached from NotReady");
+	static_assert(LIFECYCLE.hasNoDeadEnds(), "a state can not be left");
 }
 
 
-Aicraft::Aicraft()
+AicraftBase::AicraftBase()
 	: mesh(nullptr)
 {
 }
 
-Aicraft::~Aicraft()
+AicraftBase::~AicraftBase()
 {
 	removeMesh();
 }
 
-void Aicraft::init(Ship *shiparg, int sideNumber)
-{
-	assert(!mesh);
-	ship = shiparg;
-	number = sideNumber;
-	setState(AicraftState::Ready);
-	acceleration = params::aircraft::ACCELERATION;
-	flybyRadius = turnRadius(params::aircraft::LINEAR_SPEED, params::aircraft::ANGULAR_SPEED) +
-					params::aircraft::FLYBY_DISTANCE * number;
-}
-
-void Aicraft::removeMesh()
+void AicraftBase::removeMesh()
 {
 	if (mesh)
 	{
@@ -84,220 +139,477 @@ void Aicraft::removeMesh()
 	}
 }
 
-void Aicraft::update(float dt)
+bool AicraftBase::newTarget(Vector2 targetPosition)
 {
-	updateState();
-	if (state != AicraftState::MovingToTarget && state != AicraftState::MovingToBase && state != AicraftState::Takeoff)
-	{
+	const bool wasOrbiting = orbit.active;
+	leaveOrbit();
+	target = targetPosition;
+	return wasOrbiting;
+}
+
+bool AicraftBase::recall()
+{
+	if (!LIFECYCLE.accepts(state, AicraftEvent::Recalled, *this))
+		return false;
+	const bool wasOrbiting = orbit.active;
+	leaveOrbit();
+	recalled = true;
+	return wasOrbiting;
+}
+
+Vector2 AicraftBase::getPosition() const
+{
+	if (!orbit.active)
+		return position;
+	const float phase = orbitPhase();
+	return target + orbit.radius * Vector2::fromAngle(phase);
+}
+
+Vector2 AicraftBase::getGoal() const
+{
+	return state == AicraftState::MovingToBase ? ship->getPosition() : target;
+}
+
+float AicraftBase::getAngle() const
+{
+	if (!orbit.active)
+		return angle;
+	return math::scopedAngle(orbitPhase() + (orbit.rate > 0 ? math::PI / 2 : -math::PI / 2));
+}
+
+float AicraftBase::orbitPhase() const
+{
+	return orbit.startPhase + orbit.rate * static_cast<float>(ship->getTime() - orbit.startTime);
+}
+
+void AicraftBase::enterOrbit(float rate)
+{
+	const Vector2 radial = position - target;
+	orbit.radius = radial.length();
+	orbit.startPhase = atan2f(radial.y, radial.x);
+	orbit.rate = rate;
+	orbit.startTime = ship->getTime();
+	orbit.returnCheckTime = orbit.startTime;
+	orbit.active = true;
+	scene::orbitMesh(mesh, target.x, target.y, orbit.radius, orbit.startPhase, orbit.rate);
+}
+
+void AicraftBase::leaveOrbit()
+{
+	if (!orbit.active)
+		return;
+	position = getPosition();
+	angle = getAngle();
+	angularSpeed = orbit.rate;
+	orbit.active = false;
+	scene::placeMesh(mesh, position.x, position.y, angle);
+}
+
+bool AicraftBase::joinFormation(AicraftBase &leader)
+{
+	if (!leader.canLead())
+		return false;
+	const int index = leader.formation.followersCount++;
+	leader.formation.followers[index] = this;
+	formation.leader = &leader;
+	formation.slot = formationSlot(index);
+	return true;
+}
+
+bool AicraftBase::canLead() const
+{
+	return !formation.leader && formation.followersCount < params::formation::MAX_FOLLOWERS && !recalled && !orbit.active &&
+		(state == AicraftState::Takeoff || state == AicraftState::MovingToTarget) &&
+		(position - ship->getPosition()).length() < params::formation::JOIN_DISTANCE;
+}
+
+bool AicraftBase::keepsFormation() const
+{
+	const AicraftBase &leader = *formation.leader;
+	return !recalled && !leader.recalled && !leader.orbit.active && leader.state == AicraftState::MovingToTarget &&
+		(leader.position - leader.target).length() > leader.flybyRadius + params::formation::BREAK_DISTANCE;
+}
+
+// the ones behind move up a slot, so the V stays closed and the leader can take new followers
+void AicraftBase::leaveFormation()
+{
+	if (!formation.leader)
 		return;
+	Formation &group = formation.leader->formation;
+	AicraftBase **end = group.followers + group.followersCount;
+	AicraftBase **place = std::find(group.followers, end, this);
+	if (place != end)
+	{
+		for (AicraftBase **next = place + 1; next != end; ++place, ++next)
+		{
+			*place = *next;
+			(*place)->formation.slot = formationSlot(static_cast<int>(place - group.followers));
+		}
+		group.followers[--group.followersCount] = nullptr;
 	}
+	formation.leader = nullptr;
+	// pursuit turn rates are not the turns own steering makes, the return estimate should not see them
+	angularSpeed = 0;
+}
+
+void AicraftBase::handle(AicraftEvent event)
+{
+	const bool accepted = LIFECYCLE.accepts(state, event, *this);
+	assert(accepted);
+	if (!accepted)
+		return;
+	const AicraftState newState = LIFECYCLE.next(state, event);
+	GAME_LOG(game::LOG_INFO, "Aicraft %d state changed:  %s -> %s", number, toString(state), toString(newState));
+	state = newState;
+}
+
 
-	updateFlightParams(dt);
-	updatePosition(dt);
+template<class FlightModel>
+void Aicraft<FlightModel>::init(Ship *shiparg, int sideNumber)
+{
+	assert(!mesh);
+	ship = shiparg;
+	number = sideNumber;
+	handle(AicraftEvent::Prepared);
+	flybyRadius = steering::turnRadius(FlightModel::LINEAR_SPEED, FlightModel::ANGULAR_SPEED) +
+					FlightModel::FLYBY_DISTANCE * number;
 }
 
-void Aicraft::launch()
+template<class FlightModel>
+void Aicraft<FlightModel>::launch()
 {
-	setState(AicraftState::Takeoff);
+	handle(AicraftEvent::Launched);
 	position = ship->getPosition();
 	shipPosition = 0;
 	angle = ship->getAngle();
 	speed = 0;
 	angularSpeed = 0;
-	nextStateTime = std::chrono::system_clock::now();
-	nextStateTime += std::chrono::seconds(params::aircraft::FLIGHT_TIME_SEC);
+	nextStateTime = ship->getTime() + FlightModel::FLIGHT_TIME_SEC;
+	nextBurstTime = 0;
+	recalled = false;
+	formation = Formation();
+	resumePoint = 0;
 
 	mesh = scene::createAircraftMesh();
+	scene::setMeshOwner(mesh, static_cast<AicraftBase*>(this));
+	// rolls with the carrier until it is placed in the air
+	scene::attachMesh(mesh, ship->getMesh(), shipPosition, 0.f, 0.f);
 }
 
-void Aicraft::onLanded()
+template<class FlightModel>
+Await Aicraft<FlightModel>::resume(float dt)
 {
-	removeMesh();
-	setState(AicraftState::Fueling);
-	auto time = std::chrono::system_clock::now();
-	if (time > nextStateTime)
-	{
-		std::chrono::milliseconds delay = std::chrono::duration_cast<std::chrono::milliseconds>(time - nextStateTime);
-		GAME_LOG(game::LOG_ERROR, "Aicraft % i is late for %lli ms", number, delay.count());
-	}
-	nextStateTime = std::chrono::system_clock::now();
-	nextStateTime += std::chrono::seconds(params::aircraft::FUELING_TIME_SEC);
-}
+	SORTIE_BEGIN(resumePoint);
 
-void Aicraft::newTarget(Vector2 targetPosition)
-{
-	target = targetPosition;
-}
+	// roll along the deck, the step which passes the bow is finished in the air
+	while (!takeOff(dt))
+		SORTIE_AWAIT(resumePoint, Await::nextFrame());
+	SORTIE_AWAIT(resumePoint, Await::nextFrame());
 
-void Aicraft::updateState()
-{
-	const Vector2 shipVector = ship->getPosition() - position;
-	switch (state)
+	// fly to the target and loiter around it, a new target or a recall wakes a loitering aircraft up
+	while (true)
 	{
-	case AicraftState::NotReady:
-		break;
-	case AicraftState::Fueling:
-		if (std::chrono::system_clock::now() > nextStateTime)
+		if (orbit.active)
 		{
-			setState(AicraftState::Ready);
+			if (ship->getTime() >= orbit.returnCheckTime)
+			{
+				if (isTimeToGoToBase(distanceToShip()))
+				{
+					// the orbit is left at the end of this step, the way home starts with the next one
+					leaveOrbit();
+					handle(AicraftEvent::Returned);
+					SORTIE_AWAIT(resumePoint, Await::nextFrame());
+					break;
+				}
+				orbit.returnCheckTime = returnTime();
+			}
+			if (FlightModel::BURST_ROUNDS > 0 && ship->getTime() >= nextBurstTime)
+			{
+				fireBurst();
+				nextBurstTime = ship->getTime() + FlightModel::BURST_INTERVAL_SEC;
+			}
+			// armed models also wake up for the next burst
+			SORTIE_AWAIT(resumePoint, Await::until(FlightModel::BURST_ROUNDS > 0 ?
+				std::min(orbit.returnCheckTime, nextBurstTime) : orbit.returnCheckTime));
+			continue;
 		}
-		break;
-	case AicraftState::Ready:
-		break;
-	case AicraftState::Takeoff:
-		if (!ship->isOnShip(shipPosition))
-		{
-			angle = ship->getAngle();
-			angularSpeed = 0;
-			setState(AicraftState::MovingToTarget);
-		}
-		break;
-	case AicraftState::MovingToTarget:
-		if (isTimeToGoToBase())
-		{
-			setState(AicraftState::MovingToBase);
-		}
-		break;
-	case AicraftState::MovingToBase:
-		if (shipVector.length() < POS_EPS)
+
+		if (recalled || (detail.replan && isTimeToGoToBase(distanceToShip())))
 		{
-			onLanded();
+			leaveFormation();
+			handle(recalled ? AicraftEvent::Recalled : AicraftEvent::Returned);
+			break;
 		}
-		break;
-	default:
-		break;
+		flyAroundTarget(dt);
+		SORTIE_AWAIT(resumePoint, Await::nextFrame());
 	}
+
+	while (!flyToShip(dt))
+		SORTIE_AWAIT(resumePoint, Await::nextFrame());
+
+	// landed, sleep while fueling
+	SORTIE_AWAIT(resumePoint, Await::until(nextStateTime));
+	handle(AicraftEvent::Fueled);
+
+	SORTIE_END(resumePoint);
 }
 
-void Aicraft::updatePosition(float dt)
+template<class FlightModel>
+bool Aicraft<FlightModel>::takeOff(float dt)
 {
+	accelerate(dt);
+	const float flightTime = rollOnDeck(dt);
 	if (state == AicraftState::Takeoff)
 	{
-		shipPosition += speed * dt;
-		position = ship->localToGlobal(shipPosition);
-		angle = ship->getAngle();
-		scene::placeMesh(mesh, position.x, position.y, angle);
-		return;
+		scene::placeMeshLocal(mesh, shipPosition, 0.f, 0.f);
+		return false;
 	}
-
-	angle = angle + angularSpeed * dt;
-	angle = math::scopedAngle(angle);
-
-	position = position + speed * dt * Vector2(std::cos(angle), std::sin(angle));
-	scene::placeMesh(mesh, position.x, position.y, angle);
+	move(flightTime);
+	return true;
 }
 
-void Aicraft::updateFlightParams(float dt)
+template<class FlightModel>
+void Aicraft<FlightModel>::flyAroundTarget(float dt)
 {
-	if (speed < params::aircraft::LINEAR_SPEED)
+	if (formation.leader && !keepsFormation())
+		leaveFormation();
+	if (formation.leader)
 	{
-		speed += acceleration * dt;
-		if (speed > params::aircraft::LINEAR_SPEED)
-		{
-			speed = params::aircraft::LINEAR_SPEED;
-		}
+		flyInFormation(dt);
+		return;
 	}
 
-	switch (state)
-	{
-	case AicraftState::MovingToTarget:
+	accelerate(dt);
+	if (detail.replan)
 		adjustTrajectoryToMoveAroundTarget(target);
-		break;
-	case AicraftState::MovingToBase:
-		adjustTrajectoryToTarget(ship->getPosition());
-		break;
-	default:
-		break;
-	} 
+	move(dt);
+	tryEnterOrbit();
+}
+
+// a few vector operations instead of the tangent search, the leader does that for the group
+template<class FlightModel>
+void Aicraft<FlightModel>::flyInFormation(float dt)
+{
+	const AicraftBase &leader = *formation.leader;
+	const Vector2 forward = Vector2::fromAngle(leader.getAngle());
+	const Vector2 slot = leader.getPosition() + formation.slot.x * forward + formation.slot.y * forward.perpendicular();
+	angularSpeed = steering::pursue(position, angle, slot + params::formation::LEAD_DISTANCE * forward,
+									leader.getAngularSpeed(), FlightModel::ANGULAR_SPEED);
+
+	// faster while behind the slot, slower while ahead of it but never below a flying speed
+	const float gap = dot(slot - position, forward);
+	const float wantedSpeed = math::clamp(leader.getSpeed() + params::formation::CATCH_UP_GAIN * gap,
+										  FlightModel::LINEAR_SPEED * (1.f - params::formation::CATCH_UP_RATIO),
+										  FlightModel::LINEAR_SPEED * (1.f + params::formation::CATCH_UP_RATIO));
+	const float step = (1.f + params::formation::CATCH_UP_RATIO) * FlightModel::ACCELERATION * dt;
+	speed += math::clamp(wantedSpeed - speed, -step, step);
+	move(dt);
 }
 
-void Aicraft::setState(AicraftState newState)
+template<class FlightModel>
+bool Aicraft<FlightModel>::flyToShip(float dt)
 {
-	if (state != newState)
+	accelerate(dt);
+	// around islands by the carrier's flow field, straight at the deck once the way is clear
+	if (detail.replan)
+		adjustTrajectoryToTarget(ship->getFlowField().waypoint(position));
+	if (!move(dt))
+		return false;
+	onLanded();
+	return true;
+}
+
+// also slows down to the model's speed after catching up with a formation
+template<class FlightModel>
+void Aicraft<FlightModel>::accelerate(float dt)
+{
+	if (speed < FlightModel::LINEAR_SPEED)
+	{
+		speed += FlightModel::ACCELERATION * dt;
+		if (speed > FlightModel::LINEAR_SPEED)
+		{
+			speed = FlightModel::LINEAR_SPEED;
+		}
+	}
+	else if (speed > FlightModel::LINEAR_SPEED)
 	{
-		GAME_LOG(game::LOG_INFO, "Aicraft %d state changed:  %s -> %s", number, toString(state), toString(newState));
-		state = newState;
+		// not std::max, it would take the constant by reference and that needs a definition of it
+		speed -= FlightModel::ACCELERATION * dt;
+		if (speed < FlightModel::LINEAR_SPEED)
+		{
+			speed = FlightModel::LINEAR_SPEED;
+		}
 	}
 }
 
-bool Aicraft::isTimeToGoToBase() const
+// returns true if the ship is reached on the way back
+template<class FlightModel>
+bool Aicraft<FlightModel>::move(float dt)
 {
-	// rough(but not too) top estimate
-	const float circleLength = 2.f*math::PI * turnRadius(speed, angularSpeed);
-	const Vector2 shipDirection(ship->getPosition().x - position.x, ship->getPosition().y - position.y);
-	const float distance = circleLength + shipDirection.length();
-	const float needTime = distance / fabs(speed);
-	auto estimatedArrival =  std::chrono::system_clock::now();
-	estimatedArrival += std::chrono::microseconds(static_cast<int>(needTime * 1000000.f));
-	estimatedArrival += std::chrono::seconds(1);
-	if (estimatedArrival > nextStateTime)
+	const Vector2 from = position;
+	const float fromAngle = angle;
+	advanceOnArc(position, angle, speed, angularSpeed, dt);
+	position = position + dt * wind;
+
+	if (state == AicraftState::MovingToBase && isShipReached(from, fromAngle, dt))
 		return true;
+	scene::placeMesh(mesh, position.x, position.y, angle);
 	return false;
 }
 
-void Aicraft::adjustTrajectoryToTarget(Vector2 target)
+template<class FlightModel>
+void Aicraft<FlightModel>::onLanded()
 {
-	const Vector2 targetDirection = target - position;
-
-	if (targetDirection.isZero())
+	removeMesh();
+	handle(AicraftEvent::Landed);
+	const double time = ship->getTime();
+	if (time > nextStateTime)
 	{
-		return;
+		GAME_LOG(game::LOG_ERROR, "Aicraft % i is late for %lli ms", number, static_cast<long long>((time - nextStateTime) * 1000.0));
 	}
+	nextStateTime = time + FlightModel::FUELING_TIME_SEC;
+}
 
-	const float targetAngle = std::atan2f(targetDirection.y, targetDirection.x);
-	const float diff = targetAngle - angle;
-	if (math::isEqual(cosf(diff), 1))
+template<class FlightModel>
+bool Aicraft<FlightModel>::tryEnterOrbit()
+{
+	// followers which broke up are still slowing down after catching up
+	if (state != AicraftState::MovingToTarget || speed != FlightModel::LINEAR_SPEED)
+		return false;
+
+	const Vector2 radial = position - target;
+	const float distance = radial.length();
+	if (fabs(distance - flybyRadius) > POS_EPS)
+		return false;
+
+	const Vector2 heading = Vector2::fromAngle(angle);
+	if (fabs(dot(radial, heading) / distance) > ORBIT_ENTRY_COS)
+		return false;
+
+	const float direction = cross(radial, heading) > 0 ? 1.f : -1.f;
+	enterOrbit(direction * speed / distance);
+	return true;
+}
+
+// rounds fan out from the aircraft towards the middle of the flyby circle
+template<class FlightModel>
+void Aicraft<FlightModel>::fireBurst()
+{
+	const Vector2 from = getPosition();
+	const Vector2 aim = params::projectile::SPEED * (target - from).normalized();
+	Projectiles &projectiles = ship->getProjectiles();
+	for (int i = 0; i < FlightModel::BURST_ROUNDS; ++i)
 	{
-		angularSpeed = 0;
-		return;
+		const Vector2 velocity = aim.rotated(params::projectile::SPREAD * (float(i) / FlightModel::BURST_ROUNDS - 0.5f));
+		if (!projectiles.fire(from, velocity, params::projectile::LIFE_SEC))
+			break;
 	}
-	if (math::isAbsEqual(diff, math::PI))
+}
+
+template<class FlightModel>
+float Aicraft<FlightModel>::rollOnDeck(float dt)
+{
+	const float deckLeft = ship->getDeckFront() - shipPosition;
+	const float rollDistance = speed * dt;
+	if (rollDistance <= deckLeft)
 	{
-		angularSpeed = params::aircraft::ANGULAR_SPEED;
-		return;
+		shipPosition += rollDistance;
+		position = ship->localToGlobal(shipPosition);
+		angle = ship->getAngle();
+		return 0.f;
 	}
 
-	const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
-	angularSpeed = sign * params::aircraft::ANGULAR_SPEED;
+	// the bow is passed inside this step: lift off exactly there and fly the rest of the step
+	shipPosition = ship->getDeckFront();
+	position = ship->localToGlobal(shipPosition);
+	angle = ship->getAngle();
+	angularSpeed = 0;
+	handle(AicraftEvent::LiftedOff);
+	return deckLeft > 0.f ? dt - deckLeft / speed : dt;
+}
 
-	// we need adjust trajectory in case target is inside of our turn
-	const float r = turnRadius(speed, angularSpeed);
-	const Vector2 center = centerOfTurn(position, angle, speed, angularSpeed);
-	if (isPointInCircle(target, center, r - POS_EPS))
+template<class FlightModel>
+bool Aicraft<FlightModel>::isShipReached(Vector2 from, float fromAngle, float dt) const
+{
+	// both aircraft and ship move during the step, test relative swept chords of the arc
+	const int chords = 1 + static_cast<int>(fabs(angularSpeed * dt) / MAX_CHORD_ANGLE);
+	const Vector2 shipFrom = ship->getPreviousPosition();
+	const Vector2 shipStep = ship->getPosition() - shipFrom;
+	const float chordTime = dt / chords;
+
+	Vector2 chordStart = from;
+	float chordAngle = fromAngle;
+	for (int i = 1; i <= chords; ++i)
 	{
-		angularSpeed = -angularSpeed;
+		Vector2 chordEnd = chordStart;
+		if (i == chords)
+			chordEnd = position;
+		else
+		{
+			advanceOnArc(chordEnd, chordAngle, speed, angularSpeed, chordTime);
+			chordEnd = chordEnd + chordTime * wind;
+		}
+
+		const Vector2 relativeFrom = chordStart - (shipFrom + (float(i - 1) / chords) * shipStep);
+		const Vector2 relativeTo = chordEnd - (shipFrom + (float(i) / chords) * shipStep);
+		if (closestApproach(relativeFrom, relativeTo) < POS_EPS)
+			return true;
+		chordStart = chordEnd;
 	}
+	return false;
 }
 
-void Aicraft::adjustTrajectoryToMoveAroundTarget(Vector2 target)
+template<class FlightModel>
+float Aicraft<FlightModel>::distanceToShip() const
 {
-	const float r = flybyRadius;
-	if (isPointInCircle(position, target, r-POS_EPS)) // adjusting circle trajectory if aicraft get inside circle
-	{
-		angularSpeed = 0;
-		return;
-	}
+	// the whole flyby circle is within this distance while loitering
+	const FlowField &flowField = ship->getFlowField();
+	if (orbit.active)
+		return flowField.pathLength(target) + orbit.radius;
+	return flowField.pathLength(position);
+}
 
-	// Moving to target circle
-	const Vector2 direction = target - position;
-	const float targetAngle = atan2f(direction.y, direction.x);
-	const float directionTangentAngle = asinf(r / direction.length());
-	if (math::isZero(directionTangentAngle))
-	{
-		angularSpeed = 0;
-		return;
-	}
+template<class FlightModel>
+bool Aicraft<FlightModel>::isTimeToGoToBase(float distanceToShip) const
+{
+	// rough(but not too) top estimate, aircrafts which replan seldom decide that much earlier
+	const float turnRate = orbit.active ? orbit.rate :
+		(angularSpeed != 0 && !formation.leader ? angularSpeed : FlightModel::ANGULAR_SPEED);
+	const float circleLength = 2.f*math::PI * steering::turnRadius(speed, turnRate);
+	const float distance = circleLength + distanceToShip;
+	const double needTime = distance / fabs(speed) + detail.lookahead;
+	return ship->getTime() + needTime + RETURN_RESERVE_SEC > nextStateTime;
+}
+
+// earliest time the loitering aircraft may have to go back, assuming the ship sails away at full speed
+template<class FlightModel>
+double Aicraft<FlightModel>::returnTime() const
+{
+	const double now = ship->getTime();
+	const double circleLength = 2.f*math::PI * orbit.radius;
+	const double shipSpeedRatio = params::ship::LINEAR_SPEED / speed;
+	const double time = (nextStateTime - RETURN_RESERVE_SEC - (circleLength + distanceToShip()) / speed + shipSpeedRatio * now) /
+		(1.0 + shipSpeedRatio);
+	return std::max(time, now + MIN_LOITER_SLEEP_SEC);
+}
 
-	const float desiredAngle = cosf(targetAngle - directionTangentAngle - angle) > cosf(targetAngle + directionTangentAngle - angle) ?
-		targetAngle - directionTangentAngle : 
-		targetAngle + directionTangentAngle;
+template<class FlightModel>
+void Aicraft<FlightModel>::adjustTrajectoryToTarget(Vector2 target)
+{
+	const Vector2 aim = steering::windCorrectedAim(position, target, wind, speed);
+	angularSpeed = FlightModel::Steering::toTarget(position, angle, speed, angularSpeed, aim,
+												   FlightModel::ANGULAR_SPEED);
+}
 
-	const float diff = desiredAngle - angle;
-	if (math::isEqual(cosf(diff), 1))
-	{
-		angularSpeed = 0;
-		return;
-	}
-	const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
-	angularSpeed = sign * params::aircraft::ANGULAR_SPEED;
+template<class FlightModel>
+void Aicraft<FlightModel>::adjustTrajectoryToMoveAroundTarget(Vector2 target)
+{
+	const Vector2 aim = steering::windCorrectedAim(position, target, wind, speed);
+	angularSpeed = FlightModel::Steering::aroundTarget(position, angle, aim, flybyRadius,
+													   FlightModel::ANGULAR_SPEED);
 }
+
+
+template class Aicraft<flight_model::Fighter>;
+template class Aicraft<flight_model::Tanker>;
+template class Aicraft<flight_model::Awacs>;
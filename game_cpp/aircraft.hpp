@@ -2,18 +2,23 @@
 
 #include "../framework/scene.hpp"
 #include "../framework/game.hpp"
+#include "detail_scheduler.hpp"
+#include "flight_model.hpp"
+#include "sortie.hpp"
 #include "utils.hpp"
 
+#include <cstddef>
 #include <memory>
-#include <chrono>
 
 
 //-------------------------------------------------------
 //	Aircraft logic
 //-------------------------------------------------------
 
+template<class FlightModel>
 class Aicraft;
-typedef std::unique_ptr<Aicraft> AicraftPtr;
+template<class FlightModel>
+using AicraftPtr = std::unique_ptr<Aicraft<FlightModel>>;
 class Ship;
 
 enum class AicraftState
@@ -26,31 +31,95 @@ enum class AicraftState
 	MovingToBase
 };
 
+// what moves an aircraft along its lifecycle, see the transitions table in aircraft.cpp
+enum class AicraftEvent
+{
+	Prepared = 0,
+	Launched,
+	LiftedOff,
+	Returned,
+	Recalled,
+	Landed,
+	Fueled
+};
+
+constexpr size_t AICRAFT_STATES_COUNT = static_cast<size_t>(AicraftState::MovingToBase) + 1;
+constexpr size_t AICRAFT_EVENTS_COUNT = static_cast<size_t>(AicraftEvent::Fueled) + 1;
+
+const char* toString(AicraftState state);
 
-class Aicraft
+
+// State and helpers shared by all flight models, no virtual dispatch.
+// The link is owned by the squadron which schedules sorties.
+class AicraftBase : public SortieLink
 {
+	// transition guards
+	friend struct AicraftLifecycle;
 
 public:
-	Aicraft();
-	~Aicraft();
-
-	void init(Ship *ship, int sideNumber);
 	AicraftState getState() const { return state; }
-	void launch();
-	void onLanded();
-	void update(float dt);
-	void newTarget(Vector2 targetPosition);
+	int getNumber() const { return number; }
+	Vector2 getPosition() const;
+	float getAngle() const;
+	float getSpeed() const { return speed; }
+	float getAngularSpeed() const { return orbit.active ? orbit.rate : angularSpeed; }
+	bool isOrbiting() const { return orbit.active; }
+	// simulation time the current stage ends at: fueling done or flight time over
+	double getNextStateTime() const { return nextStateTime; }
+	// wind at the aircraft for the next step, sampled by the squadron for all flying aircrafts at once
+	void setWind(Vector2 value) { wind = value; }
+	// returns true if the aircraft left a loiter it was sleeping in and has to be resumed
+	bool newTarget(Vector2 targetPosition);
+	// heads back to the ship before its flight time is over, same return value as newTarget
+	bool recall();
+	Ship* getShip() const { return ship; }
+	// target on the way out, the carrier on the way back
+	Vector2 getGoal() const;
+	// set by the squadron before every resume, see DetailScheduler
+	DetailSlot& getDetail() { return detail; }
+	// takes the next free slot behind the leader, false if the leader can not take one more follower
+	bool joinFormation(AicraftBase &leader);
+	bool isInFormation() const { return formation.leader != nullptr; }
 
 protected:
+	AicraftBase();
+	~AicraftBase();
 
 	void removeMesh();
-	void updateState();
-	void updatePosition(float dt);
-	void updateFlightParams(float dt);
-	void setState(AicraftState newState);
-	bool isTimeToGoToBase() const;
-	void adjustTrajectoryToTarget(Vector2 target);
-	void adjustTrajectoryToMoveAroundTarget(Vector2 target);
+	// moves to the state the lifecycle table has for the event, which is expected to be accepted
+	void handle(AicraftEvent event);
+
+	// steady loiter is a closed form circle, position is evaluated only on demand
+	struct Orbit
+	{
+		bool active = false;
+		float radius = 0;
+		float startPhase = 0;
+		float rate = 0;
+		double startTime = 0;
+		// the return estimate is checked only then, bursts wake the aircraft in between
+		double returnCheckTime = 0;
+	};
+
+	void enterOrbit(float rate);
+	void leaveOrbit();
+	float orbitPhase() const;
+
+	// followers fly in a slot of the leader instead of steering on their own
+	struct Formation
+	{
+		AicraftBase *leader = nullptr;
+		// in the leader's frame, x along its heading and y to its left
+		Vector2 slot;
+		// while this aircraft leads, in the order of their slots
+		AicraftBase *followers[params::formation::MAX_FOLLOWERS] = {};
+		int followersCount = 0;
+	};
+
+	bool canLead() const;
+	// false once the leader has left the way to the target or is close to it
+	bool keepsFormation() const;
+	void leaveFormation();
 
 protected:
 
@@ -61,10 +130,57 @@ protected:
 	Vector2 position;
 	float shipPosition = 0;
 	Vector2 target;
-	std::chrono::time_point<std::chrono::system_clock> nextStateTime;
+	// simulation time, see Ship::getTime
+	double nextStateTime = 0;
 	float angle = 0;
 	float speed = 0;
-	float acceleration = 0;
 	float angularSpeed = 0;
 	float flybyRadius = 0;
+	Vector2 wind;
+	Orbit orbit;
+	Formation formation;
+	// simulation time of the next burst at the target
+	double nextBurstTime = 0;
+	bool recalled = false;
+	DetailSlot detail;
+	ResumePoint resumePoint = 0;
+};
+
+
+template<class FlightModel>
+class Aicraft : public AicraftBase
+{
+
+public:
+	typedef FlightModel Model;
+
+	void init(Ship *ship, int sideNumber);
+	void launch();
+	// runs the sortie until it has to wait, called by the squadron only when the wait is over
+	Await resume(float dt);
+
+protected:
+
+	bool takeOff(float dt);
+	void flyAroundTarget(float dt);
+	void flyInFormation(float dt);
+	bool flyToShip(float dt);
+	void accelerate(float dt);
+	bool move(float dt);
+	void onLanded();
+	bool tryEnterOrbit();
+	void fireBurst();
+	float rollOnDeck(float dt);
+	bool isShipReached(Vector2 from, float fromAngle, float dt) const;
+	float distanceToShip() const;
+	bool isTimeToGoToBase(float distanceToShip) const;
+	double returnTime() const;
+	void adjustTrajectoryToTarget(Vector2 target);
+	void adjustTrajectoryToMoveAroundTarget(Vector2 target);
 };
+
+
+// instantiated in aircraft.cpp
+extern template class Aicraft<flight_model::Fighter>;
+extern template class Aicraft<flight_model::Tanker>;
+extern template class Aicraft<flight_model::Awacs>;
@@ -0,0 +1,102 @@
+#include "detail_scheduler.hpp"
+
+#include "../framework/game.hpp"
+
+namespace
+{
+	bool isInRect(Vector2 point, Vector2 rectMin, Vector2 rectMax, float margin)
+	{
+		return point.x >= rectMin.x - margin && point.x <= rectMax.x + margin &&
+			point.y >= rectMin.y - margin && point.y <= rectMax.y + margin;
+	}
+}
+
+
+void DetailScheduler::beginFrame(Vector2 viewMinArg, Vector2 viewMaxArg, float dt)
+{
+	viewMin = viewMinArg;
+	viewMax = viewMaxArg;
+	frameTime = dt;
+	++frame;
+	budget = params::detail::REPLAN_BUDGET;
+	stats = Stats();
+}
+
+
+void DetailScheduler::schedule(DetailSlot &slot, Vector2 position, Vector2 goal)
+{
+	const DetailTier tier = tierOf(position, goal);
+	const int period = periodOf(tier);
+	if (tier != slot.tier)
+	{
+		// coming closer replans at once, moving away starts in the next free slice
+		if (tier > slot.tier)
+			slot.lastReplanFrame = frame - nextSlice++ % period;
+		else
+			slot.lastReplanFrame = frame - period;
+		slot.tier = tier;
+	}
+
+	switch (tier)
+	{
+	case DetailTier::Full:
+		++stats.full;
+		break;
+	case DetailTier::Reduced:
+		++stats.reduced;
+		break;
+	case DetailTier::Distant:
+		++stats.distant;
+		break;
+	}
+
+	// a replan deferred for a whole period is not deferred again, so the lookahead holds
+	const uint32_t waited = frame - slot.lastReplanFrame;
+	const bool isDue = waited >= static_cast<uint32_t>(period);
+	const bool isOverdue = waited >= static_cast<uint32_t>(2 * period);
+	slot.replan = tier == DetailTier::Full || (isDue && (budget > 0 || isOverdue));
+	if (isDue && !slot.replan)
+		++stats.deferred;
+	if (slot.replan)
+	{
+		if (tier != DetailTier::Full)
+			--budget;
+		slot.lastReplanFrame = frame;
+		++stats.replans;
+	}
+	slot.lookahead = tier == DetailTier::Full ? 0.f : 2 * period * frameTime;
+}
+
+
+void DetailScheduler::replanNow(DetailSlot &slot)
+{
+	slot.tier = DetailTier::Full;
+	slot.lastReplanFrame = frame;
+	slot.replan = true;
+	slot.lookahead = 0.f;
+}
+
+
+DetailTier DetailScheduler::tierOf(Vector2 position, Vector2 goal) const
+{
+	if (isInRect(position, viewMin, viewMax, params::detail::VIEW_MARGIN) ||
+		(goal - position).lengthSquared() < params::detail::ACTIVE_DISTANCE * params::detail::ACTIVE_DISTANCE)
+		return DetailTier::Full;
+	if (isInRect(position, viewMin, viewMax, params::detail::REDUCED_DISTANCE))
+		return DetailTier::Reduced;
+	return DetailTier::Distant;
+}
+
+
+int DetailScheduler::periodOf(DetailTier tier)
+{
+	switch (tier)
+	{
+	case DetailTier::Reduced:
+		return params::detail::REDUCED_PERIOD;
+	case DetailTier::Distant:
+		return params::detail::DISTANT_PERIOD;
+	default:
+		return 1;
+	}
+}
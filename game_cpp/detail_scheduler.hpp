@@ -0,0 +1,70 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <cstdint>
+
+
+//-------------------------------------------------------
+//	Level of detail of aircraft updates
+//	aircrafts in the view or close to where they fly replan steering and
+//	the return estimate every frame. The rest replan every few frames,
+//	staggered over frames and capped by a per-frame budget, and keep
+//	their turn rate in between.
+//-------------------------------------------------------
+
+enum class DetailTier
+{
+	Full = 0,
+	Reduced,
+	Distant
+};
+
+
+// kept by every aircraft, only the scheduler changes it
+struct DetailSlot
+{
+	DetailTier tier = DetailTier::Full;
+	uint32_t lastReplanFrame = 0;
+	bool replan = true;
+	// the next replan is at most this far away, the return estimate allows for it
+	float lookahead = 0.f;
+};
+
+
+class DetailScheduler
+{
+public:
+	struct Stats
+	{
+		uint32_t full = 0;
+		uint32_t reduced = 0;
+		uint32_t distant = 0;
+		uint32_t replans = 0;
+		uint32_t deferred = 0;
+	};
+
+	// view in world coordinates, once per frame before aircrafts are resumed
+	void beginFrame(Vector2 viewMin, Vector2 viewMax, float dt);
+
+	// decides if the airborne aircraft replans in this frame, goal is where it flies to
+	void schedule(DetailSlot &slot, Vector2 position, Vector2 goal);
+	// for aircrafts resumed because their sleep is over, they always replan
+	void replanNow(DetailSlot &slot);
+
+	// counts of the last frame
+	const Stats& getStats() const { return stats; }
+
+private:
+	DetailTier tierOf(Vector2 position, Vector2 goal) const;
+	static int periodOf(DetailTier tier);
+
+	Vector2 viewMin;
+	Vector2 viewMax;
+	float frameTime = 0.f;
+	uint32_t frame = 0;
+	// spreads aircrafts which leave the view together over the frames of their period
+	uint32_t nextSlice = 0;
+	int budget = 0;
+	Stats stats;
+};
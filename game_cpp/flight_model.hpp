@@ -0,0 +1,188 @@
+#pragma once
+
+#include "../framework/game.hpp"
+#include "utils.hpp"
+
+#include <cmath>
+
+
+//-------------------------------------------------------
+//	Steering strategies
+//-------------------------------------------------------
+
+namespace steering
+{
+	constexpr float POS_EPS = 0.1f;
+
+	inline float turnRadius(float speed, float angularSpeed)
+	{
+		return fabs(speed / angularSpeed);
+	}
+
+	inline Vector2 centerOfTurn(Vector2 position, float angle, float speed, float angularSpeed)
+	{
+		const float normalAngle = angularSpeed > 0 ? angle + math::PI / 2 : angle - math::PI / 2;
+		Vector2 normal{cosf(normalAngle), sinf(normalAngle)};
+		const float r = turnRadius(speed, angularSpeed);
+		normal = r*normal;
+		const Vector2 center = position + normal;
+		return center;
+	}
+
+	inline bool isPointInCircle(Vector2 point, Vector2 center, float r)
+	{
+		const Vector2 diff = point - center;
+		return diff.length() <= r;
+	}
+
+	// aims upwind of the target by the drift expected on the way, so the track ends at the target
+	inline Vector2 windCorrectedAim(Vector2 position, Vector2 target, Vector2 wind, float speed)
+	{
+		const float flightTime = (target - position).length() / speed;
+		return target - flightTime * wind;
+	}
+
+	// Keeps a slot which moves with the leader: turns with the leader plus a rate proportional
+	// to the heading error to a point ahead of the slot, at most with the maximum rate.
+	inline float pursue(Vector2 position, float angle, Vector2 aim, float leaderAngularSpeed, float maxAngularSpeed)
+	{
+		const Vector2 direction = aim - position;
+		const float distance = direction.length();
+		if (math::isZero(distance))
+			return leaderAngularSpeed;
+
+		const Vector2 heading = Vector2::fromAngle(angle);
+		const float sinError = cross(heading, direction) / distance;
+		if (dot(heading, direction) < 0)
+			return sinError >= 0 ? maxAngularSpeed : -maxAngularSpeed;
+		return math::clamp(leaderAngularSpeed + params::formation::TURN_GAIN * sinError, -maxAngularSpeed, maxAngularSpeed);
+	}
+
+	// Turns with the maximum rate until the aircraft heads to the target,
+	// approaches the flyby circle along its tangent.
+	// Returns new angular speed, maxAngularSpeed is expected to be a compile time constant.
+	struct Tangent
+	{
+		static float toTarget(Vector2 position, float angle, float speed, float angularSpeed,
+							  Vector2 target, float maxAngularSpeed);
+		static float aroundTarget(Vector2 position, float angle, Vector2 target, float flybyRadius,
+								  float maxAngularSpeed);
+	};
+
+
+	inline float Tangent::toTarget(Vector2 position, float angle, float speed, float angularSpeed,
+								   Vector2 target, float maxAngularSpeed)
+	{
+		const Vector2 targetDirection = target - position;
+
+		if (targetDirection.isZero())
+		{
+			return angularSpeed;
+		}
+
+		const float targetAngle = std::atan2(targetDirection.y, targetDirection.x);
+		const float diff = targetAngle - angle;
+		if (math::isEqual(cosf(diff), 1))
+		{
+			return 0;
+		}
+		if (math::isAbsEqual(diff, math::PI))
+		{
+			return maxAngularSpeed;
+		}
+
+		const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
+		angularSpeed = sign * maxAngularSpeed;
+
+		// we need adjust trajectory in case target is inside of our turn
+		const float r = turnRadius(speed, angularSpeed);
+		const Vector2 center = centerOfTurn(position, angle, speed, angularSpeed);
+		if (isPointInCircle(target, center, r - POS_EPS))
+		{
+			angularSpeed = -angularSpeed;
+		}
+		return angularSpeed;
+	}
+
+	inline float Tangent::aroundTarget(Vector2 position, float angle, Vector2 target, float flybyRadius,
+									   float maxAngularSpeed)
+	{
+		const float r = flybyRadius;
+		if (isPointInCircle(position, target, r-POS_EPS)) // adjusting circle trajectory if aicraft get inside circle
+		{
+			return 0;
+		}
+
+		// Moving to target circle
+		const Vector2 direction = target - position;
+		const float targetAngle = atan2f(direction.y, direction.x);
+		const float directionTangentAngle = asinf(r / direction.length());
+		if (math::isZero(directionTangentAngle))
+		{
+			return 0;
+		}
+
+		const float desiredAngle = cosf(targetAngle - directionTangentAngle - angle) > cosf(targetAngle + directionTangentAngle - angle) ?
+			targetAngle - directionTangentAngle :
+			targetAngle + directionTangentAngle;
+
+		const float diff = desiredAngle - angle;
+		if (math::isEqual(cosf(diff), 1))
+		{
+			return 0;
+		}
+		const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
+		return sign * maxAngularSpeed;
+	}
+}
+
+
+//-------------------------------------------------------
+//	Flight models
+//	Every aircraft class is described by a policy with compile time
+//	constants and a steering strategy, Aicraft<Model> is specialized for it.
+//-------------------------------------------------------
+
+namespace flight_model
+{
+	struct Fighter
+	{
+		static constexpr float LINEAR_SPEED = params::aircraft::LINEAR_SPEED;
+		static constexpr float ACCELERATION = params::aircraft::ACCELERATION;
+		static constexpr float ANGULAR_SPEED = params::aircraft::ANGULAR_SPEED;
+		static constexpr int FLIGHT_TIME_SEC = params::aircraft::FLIGHT_TIME_SEC;
+		static constexpr int FUELING_TIME_SEC = params::aircraft::FUELING_TIME_SEC;
+		static constexpr float FLYBY_DISTANCE = params::aircraft::FLYBY_DISTANCE;
+		static constexpr int BURST_ROUNDS = params::aircraft::BURST_ROUNDS;
+		static constexpr float BURST_INTERVAL_SEC = params::aircraft::BURST_INTERVAL_SEC;
+		typedef steering::Tangent Steering;
+	};
+
+	// Carriers take fighters only, tankers and AWACS fly in the mixed wing scenario
+	// of trajectory_check, next to fighters in the same air wing.
+	struct Tanker
+	{
+		static constexpr float LINEAR_SPEED = 1.8f;
+		static constexpr float ACCELERATION = 0.15f;
+		static constexpr float ANGULAR_SPEED = 0.15 * 2 * 3.14f;
+		static constexpr int FLIGHT_TIME_SEC = 180;
+		static constexpr int FUELING_TIME_SEC = 40;
+		static constexpr float FLYBY_DISTANCE = 0.3f;
+		static constexpr int BURST_ROUNDS = 0;
+		static constexpr float BURST_INTERVAL_SEC = 0.f;
+		typedef steering::Tangent Steering;
+	};
+
+	struct Awacs
+	{
+		static constexpr float LINEAR_SPEED = 1.5f;
+		static constexpr float ACCELERATION = 0.1f;
+		static constexpr float ANGULAR_SPEED = 0.1 * 2 * 3.14f;
+		static constexpr int FLIGHT_TIME_SEC = 240;
+		static constexpr int FUELING_TIME_SEC = 60;
+		static constexpr float FLYBY_DISTANCE = 0.5f;
+		static constexpr int BURST_ROUNDS = 0;
+		static constexpr float BURST_INTERVAL_SEC = 0.f;
+		typedef steering::Tangent Steering;
+	};
+}
@@ -0,0 +1,445 @@
+#include "flight_recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <windows.h>
+
+#include "../framework/game.hpp"
+
+namespace
+{
+	using namespace flight_recorder;
+
+	constexpr char FILE_MAGIC[8] = { 'W', 'O', 'T', 'S', 'F', 'D', 'R', '1' };
+	constexpr uint32_t BLOCK_MAGIC = 0x4B4C4246; // "FBLK"
+
+	constexpr float POSITION_SCALE = 4096.f;
+	constexpr float ANGLE_SCALE = 65536.f / (2.f * math::PI);
+	constexpr float SPEED_SCALE = 4096.f;
+	constexpr double TIME_SCALE = 1e6;
+
+	// views start at multiples of the allocation granularity, which is 64K on Windows
+	constexpr uint64_t MAP_GRANULARITY = 64 * 1024;
+	constexpr uint64_t MAP_WINDOW = 16 * 1024 * 1024;
+
+	constexpr int FIRST_ROW_COLUMN = COLUMN_ID;
+	// a block of the whole world at five bytes a varint, columns then never grow while recording
+	constexpr size_t MAX_TICK_ROWS = params::world::SHIPS_COUNT * (1 + params::ship::AICRAFTS_COUNT);
+	constexpr size_t MAX_VARINT_BYTES = 5;
+
+
+	void writeVarint(std::vector<uint8_t> &out, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	void writeSigned(std::vector<uint8_t> &out, int32_t value)
+	{
+		writeVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+	}
+
+	bool readVarint(const std::vector<uint8_t> &in, size_t &cursor, uint64_t &value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			if (cursor == in.size())
+				return false;
+			const uint8_t next = in[cursor++];
+			value |= static_cast<uint64_t>(next & 0x7F) << shift;
+			if (!(next & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	bool readSigned(const std::vector<uint8_t> &in, size_t &cursor, int32_t &value)
+	{
+		uint64_t raw;
+		if (!readVarint(in, cursor, raw))
+			return false;
+		const uint32_t bits = static_cast<uint32_t>(raw);
+		value = static_cast<int32_t>((bits >> 1) ^ (~(bits & 1) + 1));
+		return true;
+	}
+
+	// angles wrap around a turn, their deltas wrap in 16 bits
+	int32_t delta(int column, uint32_t from, uint32_t to)
+	{
+		if (column == COLUMN_ANGLE)
+			return static_cast<int16_t>(static_cast<uint16_t>(to - from));
+		return static_cast<int32_t>(to - from);
+	}
+
+	uint32_t applyDelta(int column, uint32_t from, int32_t value)
+	{
+		const uint32_t to = from + static_cast<uint32_t>(value);
+		return column == COLUMN_ANGLE ? static_cast<uint16_t>(to) : to;
+	}
+
+	uint32_t quantize(float value, float scale)
+	{
+		return static_cast<uint32_t>(static_cast<int32_t>(std::lround(value * scale)));
+	}
+
+	float dequantize(uint32_t value, float scale)
+	{
+		return static_cast<int32_t>(value) / scale;
+	}
+}
+
+
+//-------------------------------------------------------
+//	FlightRecorder
+//-------------------------------------------------------
+
+FlightRecorder::FlightRecorder(const char *path) :
+	queue(QUEUE_FRAMES),
+	droppedFrames(0),
+	bytesWritten(0)
+{
+	if (!file.open(path))
+	{
+		GAME_LOG(game::LOG_ERROR, "Can not create flight record %s", path);
+		return;
+	}
+
+	uint8_t *out = file.reserve(sizeof(FILE_MAGIC));
+	if (!out)
+	{
+		file.close();
+		return;
+	}
+	memcpy(out, FILE_MAGIC, sizeof(FILE_MAGIC));
+	file.commit(sizeof(FILE_MAGIC));
+	bytesWritten = sizeof(FILE_MAGIC);
+	for (std::vector<uint8_t> &column : columns)
+		column.reserve(BLOCK_TICKS * MAX_TICK_ROWS * MAX_VARINT_BYTES);
+	open = true;
+	worker = std::thread(&FlightRecorder::run, this);
+}
+
+
+FlightRecorder::~FlightRecorder()
+{
+	if (!open)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	worker.join();
+	file.close();
+	GAME_LOG(game::LOG_INFO, "Flight record closed, %llu bytes, %llu frames dropped",
+			 static_cast<unsigned long long>(bytesWritten), static_cast<unsigned long long>(droppedFrames));
+}
+
+
+void FlightRecorder::record(float dt)
+{
+	time += dt;
+	simFrame.time = time;
+	if (open)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (count == QUEUE_FRAMES)
+				++droppedFrames;
+			else
+			{
+				// the slot gives back a frame the worker is done with, so buffers are reused
+				std::swap(simFrame, queue[(head + count) % QUEUE_FRAMES]);
+				++count;
+			}
+		}
+		wakeUp.notify_one();
+	}
+	simFrame.snapshot.entities.clear();
+}
+
+
+void FlightRecorder::run()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this] { return count > 0 || stopping; });
+			if (count == 0)
+				break;
+		}
+
+		// the sim thread does not touch the head slot until it is released
+		encode(queue[head]);
+		if (blockTicks == BLOCK_TICKS)
+			writeBlock();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		head = (head + 1) % QUEUE_FRAMES;
+		--count;
+	}
+	writeBlock();
+}
+
+
+void FlightRecorder::encode(const Frame &frame)
+{
+	const uint64_t frameTime = static_cast<uint64_t>(frame.time * TIME_SCALE);
+	writeVarint(columns[COLUMN_TIME], frameTime - previousTime);
+	previousTime = frameTime;
+
+	const std::vector<EntityPose> &entities = frame.snapshot.entities;
+	writeVarint(columns[COLUMN_ROWS], entities.size());
+	if (previous.size() < entities.size())
+		previous.resize(entities.size(), Row{});
+
+	for (size_t i = 0; i < entities.size(); ++i)
+	{
+		const EntityPose &pose = entities[i];
+		const Row row = {
+			pose.id,
+			static_cast<uint32_t>(pose.kind),
+			static_cast<uint32_t>(pose.state),
+			quantize(pose.x, POSITION_SCALE),
+			quantize(pose.y, POSITION_SCALE),
+			static_cast<uint32_t>(std::lround(math::scopedAngle(pose.angle) * ANGLE_SCALE) & 0xFFFF),
+			quantize(pose.speed, SPEED_SCALE),
+			quantize(pose.angularSpeed, SPEED_SCALE)
+		};
+
+		// fields follow the row columns in order
+		const uint32_t *values = &row.id;
+		const uint32_t *base = &previous[i].id;
+		for (int column = FIRST_ROW_COLUMN; column < COLUMNS_COUNT; ++column)
+		{
+			const int field = column - FIRST_ROW_COLUMN;
+			writeSigned(columns[column], delta(column, base[field], values[field]));
+		}
+		previous[i] = row;
+	}
+	++blockTicks;
+}
+
+
+void FlightRecorder::writeBlock()
+{
+	if (blockTicks == 0)
+		return;
+
+	BlockHeader header = {};
+	header.magic = BLOCK_MAGIC;
+	header.ticks = blockTicks;
+	size_t size = sizeof(header);
+	for (int column = 0; column < COLUMNS_COUNT; ++column)
+	{
+		header.columnSizes[column] = static_cast<uint32_t>(columns[column].size());
+		size += columns[column].size();
+	}
+
+	uint8_t *out = file.reserve(size);
+	if (out)
+	{
+		memcpy(out, &header, sizeof(header));
+		out += sizeof(header);
+		for (std::vector<uint8_t> &column : columns)
+		{
+			if (!column.empty())
+				memcpy(out, column.data(), column.size());
+			out += column.size();
+		}
+		file.commit(size);
+		bytesWritten += size;
+	}
+
+	// blocks are decoded on their own, deltas start from zero again
+	for (std::vector<uint8_t> &column : columns)
+		column.clear();
+	std::fill(previous.begin(), previous.end(), Row{});
+	previousTime = 0;
+	blockTicks = 0;
+}
+
+
+bool FlightRecorder::MappedFile::open(const char *path)
+{
+	HANDLE handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+		return false;
+	file = handle;
+	written = 0;
+	return true;
+}
+
+
+uint8_t* FlightRecorder::MappedFile::reserve(size_t bytes)
+{
+	if (view && written + bytes <= viewOffset + viewSize)
+		return view + (written - viewOffset);
+
+	// the file grows to the end of the new window, it is cut to the written size on close
+	unmap();
+	viewOffset = written - written % MAP_GRANULARITY;
+	viewSize = std::max(MAP_WINDOW, written - viewOffset + bytes);
+	const uint64_t end = viewOffset + viewSize;
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), nullptr);
+	if (!mapping)
+	{
+		GAME_LOG(game::LOG_ERROR, "Can not map flight record, %llu bytes", static_cast<unsigned long long>(end));
+		return nullptr;
+	}
+	view = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_WRITE, static_cast<DWORD>(viewOffset >> 32),
+											   static_cast<DWORD>(viewOffset), static_cast<size_t>(viewSize)));
+	if (!view)
+	{
+		unmap();
+		return nullptr;
+	}
+	return view + (written - viewOffset);
+}
+
+
+void FlightRecorder::MappedFile::unmap()
+{
+	if (view)
+		UnmapViewOfFile(view);
+	if (mapping)
+		CloseHandle(mapping);
+	view = nullptr;
+	mapping = nullptr;
+}
+
+
+void FlightRecorder::MappedFile::close()
+{
+	unmap();
+	if (!file)
+		return;
+	LARGE_INTEGER size;
+	size.QuadPart = static_cast<LONGLONG>(written);
+	SetFilePointerEx(file, size, nullptr, FILE_BEGIN);
+	SetEndOfFile(file);
+	CloseHandle(file);
+	file = nullptr;
+}
+
+
+//-------------------------------------------------------
+//	FlightDataReader
+//-------------------------------------------------------
+
+bool FlightDataReader::open(const char *path)
+{
+	file.open(path, std::ios::binary);
+	char magic[sizeof(FILE_MAGIC)];
+	if (!file.read(magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+	{
+		GAME_LOG(game::LOG_ERROR, "%s is not a flight record", path);
+		return false;
+	}
+	ticksLeft = 0;
+	return true;
+}
+
+
+bool FlightDataReader::next(double &time, WorldSnapshot &snapshot)
+{
+	if (ticksLeft == 0 && !readBlock())
+		return false;
+
+	uint64_t timeDelta = 0;
+	uint64_t rows = 0;
+	if (!readVarint(columns[COLUMN_TIME], cursors[COLUMN_TIME], timeDelta) ||
+		!readVarint(columns[COLUMN_ROWS], cursors[COLUMN_ROWS], rows))
+		return false;
+	previousTime += timeDelta;
+	time = previousTime / TIME_SCALE;
+
+	uint32_t *values[COLUMNS_COUNT] = {};
+	for (int column = FIRST_ROW_COLUMN; column < COLUMNS_COUNT; ++column)
+	{
+		if (previous[column].size() < rows)
+			previous[column].resize(rows, 0);
+		values[column] = previous[column].data();
+	}
+
+	snapshot.entities.resize(rows);
+	for (size_t i = 0; i < rows; ++i)
+	{
+		for (int column = FIRST_ROW_COLUMN; column < COLUMNS_COUNT; ++column)
+		{
+			int32_t value;
+			if (!readSigned(columns[column], cursors[column], value))
+				return false;
+			values[column][i] = applyDelta(column, values[column][i], value);
+		}
+
+		EntityPose &pose = snapshot.entities[i];
+		pose.id = static_cast<uint16_t>(values[COLUMN_ID][i]);
+		pose.kind = static_cast<EntityKind>(values[COLUMN_KIND][i]);
+		pose.state = static_cast<AicraftState>(values[COLUMN_STATE][i]);
+		pose.x = dequantize(values[COLUMN_X][i], POSITION_SCALE);
+		pose.y = dequantize(values[COLUMN_Y][i], POSITION_SCALE);
+		pose.angle = values[COLUMN_ANGLE][i] / ANGLE_SCALE;
+		pose.speed = dequantize(values[COLUMN_SPEED][i], SPEED_SCALE);
+		pose.angularSpeed = dequantize(values[COLUMN_ANGULAR_SPEED][i], SPEED_SCALE);
+	}
+	--ticksLeft;
+	return true;
+}
+
+
+bool FlightDataReader::readBlock()
+{
+	BlockHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != BLOCK_MAGIC || header.ticks == 0)
+		return false;
+
+	for (int column = 0; column < COLUMNS_COUNT; ++column)
+	{
+		columns[column].resize(header.columnSizes[column]);
+		if (header.columnSizes[column] > 0 && !file.read(reinterpret_cast<char*>(columns[column].data()), header.columnSizes[column]))
+			return false;
+		cursors[column] = 0;
+		std::fill(previous[column].begin(), previous[column].end(), 0);
+	}
+	previousTime = 0;
+	ticksLeft = header.ticks;
+	return true;
+}
+
+
+//-------------------------------------------------------
+//	Command line
+//-------------------------------------------------------
+
+namespace flight_recorder
+{
+	int dump(const char *path)
+	{
+		FlightDataReader reader;
+		if (!reader.open(path))
+			return 1;
+
+		double time = 0;
+		WorldSnapshot snapshot;
+		printf("time,id,kind,state,x,y,angle,speed,angular_speed\n");
+		while (reader.next(time, snapshot))
+		{
+			for (const EntityPose &pose : snapshot.entities)
+			{
+				printf("%.6f,%u,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f\n", time, pose.id, static_cast<unsigned>(pose.kind),
+					   static_cast<unsigned>(pose.state), pose.x, pose.y, pose.angle, pose.speed, pose.angularSpeed);
+			}
+		}
+		return 0;
+	}
+}
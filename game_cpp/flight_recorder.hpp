@@ -0,0 +1,158 @@
+#pragma once
+
+#include "world_stream.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Flight data recorder
+//	every tick of ship and aircraft poses, speeds and states goes to a file
+//	in blocks of ticks. Inside a block values are stored column by column,
+//	each value as a varint delta from the same row of the previous tick.
+//	Sim thread only swaps the filled frame into a queue, a worker thread
+//	encodes blocks and copies them into a memory mapped window of the file.
+//-------------------------------------------------------
+
+namespace flight_recorder
+{
+	enum Column
+	{
+		COLUMN_TIME,
+		COLUMN_ROWS,
+		COLUMN_ID,
+		COLUMN_KIND,
+		COLUMN_STATE,
+		COLUMN_X,
+		COLUMN_Y,
+		COLUMN_ANGLE,
+		COLUMN_SPEED,
+		COLUMN_ANGULAR_SPEED,
+		COLUMNS_COUNT
+	};
+
+	struct BlockHeader
+	{
+		uint32_t magic;
+		uint32_t ticks;
+		uint32_t columnSizes[COLUMNS_COUNT];
+	};
+
+	// entry point for the command line, prints a recording as csv, returns the process exit code
+	int dump(const char *path);
+}
+
+
+class FlightRecorder
+{
+public:
+	// the file is created at once, nothing is recorded if it can not be
+	explicit FlightRecorder(const char *path);
+	// writes the ticks still queued and cuts the file to its data
+	~FlightRecorder();
+
+	bool isOpen() const { return open; }
+	// filled by the sim thread for the next record
+	WorldSnapshot& frame() { return simFrame.snapshot; }
+	// hands the frame over to the worker, drops it if the worker is a whole queue behind
+	void record(float dt);
+
+	uint64_t getDroppedFrames() const { return droppedFrames; }
+	uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+	static constexpr size_t QUEUE_FRAMES = 64;
+	static constexpr uint32_t BLOCK_TICKS = 64;
+
+	struct Frame
+	{
+		double time = 0;
+		WorldSnapshot snapshot;
+	};
+
+	struct Row
+	{
+		uint32_t id;
+		uint32_t kind;
+		uint32_t state;
+		uint32_t x;
+		uint32_t y;
+		uint32_t angle;
+		uint32_t speed;
+		uint32_t angularSpeed;
+	};
+
+	// grows the file by windows, written bytes are flushed by the system
+	class MappedFile
+	{
+	public:
+		bool open(const char *path);
+		// room for that many bytes after the written ones, valid until the next call
+		uint8_t* reserve(size_t bytes);
+		void commit(size_t bytes) { written += bytes; }
+		void close();
+
+	private:
+		void unmap();
+
+		void *file = nullptr;
+		void *mapping = nullptr;
+		uint8_t *view = nullptr;
+		uint64_t viewOffset = 0;
+		uint64_t viewSize = 0;
+		uint64_t written = 0;
+	};
+
+	void run();
+	void encode(const Frame &frame);
+	void writeBlock();
+
+	bool open = false;
+	double time = 0;
+	Frame simFrame;
+
+	// frames from head on are waiting for the worker
+	std::vector<Frame> queue;
+	size_t head = 0;
+	size_t count = 0;
+	bool stopping = false;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+	std::atomic<uint64_t> droppedFrames;
+	std::atomic<uint64_t> bytesWritten;
+
+	// worker only
+	MappedFile file;
+	std::vector<uint8_t> columns[flight_recorder::COLUMNS_COUNT];
+	std::vector<Row> previous;
+	uint64_t previousTime = 0;
+	uint32_t blockTicks = 0;
+
+	std::thread worker;
+};
+
+
+// streams a recording back tick by tick, one block is read at a time
+class FlightDataReader
+{
+public:
+	bool open(const char *path);
+	// false at the end of the recording or at a damaged block
+	bool next(double &time, WorldSnapshot &snapshot);
+
+private:
+	bool readBlock();
+
+	std::ifstream file;
+	uint32_t ticksLeft = 0;
+	std::vector<uint8_t> columns[flight_recorder::COLUMNS_COUNT];
+	size_t cursors[flight_recorder::COLUMNS_COUNT] = {};
+	std::vector<uint32_t> previous[flight_recorder::COLUMNS_COUNT];
+	uint64_t previousTime = 0;
+};
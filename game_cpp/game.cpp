@@ -2,10 +2,12 @@
 #include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <memory>
 
 #include <windows.h>  // for logging only
 
-#include "ship.hpp"
+#include "flight_recorder.hpp"
+#include "world.hpp"
 
 
 //-------------------------------------------------------
@@ -14,36 +16,62 @@
 
 namespace game
 {
-	Ship ship;
+	World world;
+	std::unique_ptr<WorldStreamPublisher> streamPublisher;
+	std::unique_ptr<FlightRecorder> flightRecorder;
 
 
-	void init()
+	void init( const Outputs &outputs )
 	{
-		ship.init();
+		world.init();
+		if ( outputs.stream == Outputs::STREAM_UDP )
+		{
+			streamPublisher = std::make_unique<WorldStreamPublisher>(
+				std::make_unique<UdpTransport>( params::stream::PUBLISHER_PORT, params::stream::SPECTATOR_PORT ) );
+		}
+		else if ( outputs.stream == Outputs::STREAM_LOOPBACK )
+		{
+			// the other end goes away at once, the publisher's queue fills up and further datagrams are dropped
+			streamPublisher = std::make_unique<WorldStreamPublisher>( std::move( LoopbackTransport::makePair().first ) );
+		}
+		if ( outputs.recorderPath )
+			flightRecorder = std::make_unique<FlightRecorder>( outputs.recorderPath );
 	}
 
 
 	void deinit()
 	{
-		ship.deinit();
+		streamPublisher.reset();
+		flightRecorder.reset();
+		world.deinit();
 	}
 
 
 	void update( float dt )
 	{
-		ship.update( dt );
+		world.update( dt );
+		if ( streamPublisher )
+		{
+			world.collectPoses( streamPublisher->snapshot() );
+			streamPublisher->publish();
+		}
+		if ( flightRecorder )
+		{
+			world.collectPoses( flightRecorder->frame() );
+			flightRecorder->record( dt );
+		}
 	}
 
 
 	void keyPressed( int key )
 	{
-		ship.keyPressed( key );
+		world.keyPressed( key );
 	}
 
 
 	void keyReleased( int key )
 	{
-		ship.keyReleased( key );
+		world.keyReleased( key );
 	}
 
 
@@ -51,7 +79,7 @@ namespace game
 	{
 		Vector2 worldPosition( x, y );
 		scene::screenToWorld( &worldPosition.x, &worldPosition.y );
-		ship.mouseClicked( worldPosition, isLeftButton );
+		world.mouseClicked( worldPosition, isLeftButton );
 	}
 
 	void log(LogLevel level, const char* text)
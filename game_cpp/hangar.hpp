@@ -0,0 +1,277 @@
+#pragma once
+
+#include "aircraft.hpp"
+#include "detail_scheduler.hpp"
+#include "intrusive_queue.hpp"
+#include "sortie.hpp"
+#include "wind_field.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Hangar and sortie scheduler of one flight model
+//	aircrafts are tracked by what their sortie waits for, so launch is O(1)
+//	and only aircrafts with something to do are resumed in a frame.
+//	Airborne ones are grouped by state and resumed group by group,
+//	aircrafts launched one after another fly in formation behind the first,
+//	how much of their steering is redone is up to the detail scheduler.
+//-------------------------------------------------------
+
+template<class FlightModel>
+class Squadron
+{
+public:
+	typedef Aicraft<FlightModel> Unit;
+
+	Squadron() = default;
+	Squadron(const Squadron&) = delete;
+	Squadron& operator=(const Squadron&) = delete;
+	~Squadron() { clear(); }
+
+	void add(AicraftPtr<FlightModel> aicraft)
+	{
+		Unit *unit = aicraft.get();
+		assert(unit->getState() == AicraftState::Ready);
+		unit->scheduler = this;
+		aicrafts.push_back(std::move(aicraft));
+		ready.pushBack(unit);
+		// a loiter left early leaves a stale entry behind, they are dropped before the heap would outgrow this
+		sleeping.reserve(2 * aicrafts.size());
+		windSamples.reserve(aicrafts.size());
+	}
+
+	bool hasReady() const { return !ready.empty(); }
+	size_t readyCount() const { return ready.size(); }
+	size_t sleepingCount() const { return sleepingUnits; }
+	size_t airborneCount() const
+	{
+		size_t count = 0;
+		for (const IntrusiveQueue<Unit> &group : airborne)
+			count += group.size();
+		return count;
+	}
+	size_t airborneCount(AicraftState state) const { return airborne[static_cast<size_t>(state)].size(); }
+
+	// launches the aircraft which became ready first, nullptr if there is none.
+	// It follows the last leader while that one is still close to the carrier, or leads itself
+	Unit* launch()
+	{
+		Unit *unit = ready.popFront();
+		if (unit)
+		{
+			unit->launch();
+			if (!leader || !unit->joinFormation(*leader))
+				leader = unit;
+			fly(unit);
+		}
+		return unit;
+	}
+
+	// wakes up aircrafts which were loitering around the previous target
+	void newTarget(Vector2 target)
+	{
+		for (auto &aicraft : aicrafts)
+		{
+			if (aicraft->newTarget(target))
+				wakeUp(aicraft.get());
+		}
+	}
+
+	// sends the aircraft home if it belongs to this squadron and is on its way out or loitering
+	void recall(AicraftBase *target)
+	{
+		if (target->scheduler != this)
+			return;
+		Unit *unit = static_cast<Unit*>(target);
+		if (unit->recall())
+			wakeUp(unit);
+	}
+
+	void update(double now, float dt, const WindField &wind, DetailScheduler &detail)
+	{
+		sampleWind(now, wind);
+		size_t sample = 0;
+		// every group runs the same part of the sortie, ones which changed state join their new group after all groups
+		for (IntrusiveQueue<Unit> &group : airborne)
+		{
+			group.forEach([this, &group, dt, &sample, &detail](Unit &unit)
+			{
+				unit.setWind(Vector2(windSamples.u[sample], windSamples.v[sample]));
+				++sample;
+				detail.schedule(unit.getDetail(), unit.getPosition(), unit.getGoal());
+				const AicraftState state = unit.getState();
+				const Await await = unit.resume(dt);
+				if (await.kind != Await::NextFrame)
+				{
+					group.remove(&unit);
+					suspend(&unit, await);
+				}
+				else if (unit.getState() != state)
+				{
+					group.remove(&unit);
+					regrouped.pushBack(&unit);
+				}
+			});
+		}
+		while (Unit *unit = regrouped.popFront())
+			fly(unit);
+
+		// woken aircrafts sleep again later than now or go to the airborne queue behind the pass above
+		while (!sleeping.empty() && sleeping.front().time <= now)
+		{
+			std::pop_heap(sleeping.begin(), sleeping.end(), wakesLater);
+			const Sleeper sleeper = sleeping.back();
+			sleeping.pop_back();
+			if (!isSleepingUntil(sleeper))
+				continue;
+
+			--sleepingUnits;
+			sleeper.unit->wakeTime = SortieLink::NOT_SLEEPING;
+			sleeper.unit->setWind(wind.sample(sleeper.unit->getPosition(), now));
+			detail.replanNow(sleeper.unit->getDetail());
+			const Await await = sleeper.unit->resume(dt);
+			if (await.kind == Await::NextFrame)
+				fly(sleeper.unit);
+			else
+				suspend(sleeper.unit, await);
+		}
+	}
+
+	// every aircraft in the order they were added
+	template<class Func>
+	void forEach(Func func)
+	{
+		for (auto &aicraft : aicrafts)
+			func(*aicraft);
+	}
+
+	template<class Func>
+	void forEach(Func func) const
+	{
+		for (const auto &aicraft : aicrafts)
+			func(static_cast<const Unit&>(*aicraft));
+	}
+
+	void clear()
+	{
+		ready.clear();
+		for (IntrusiveQueue<Unit> &group : airborne)
+			group.clear();
+		sleeping.clear();
+		sleepingUnits = 0;
+		leader = nullptr;
+		aicrafts.clear();
+	}
+
+private:
+	// positions of flying aircrafts in one array each, so the field samples them in a single batch
+	struct WindSamples
+	{
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> u;
+		std::vector<float> v;
+
+		void reserve(size_t count)
+		{
+			x.reserve(count);
+			y.reserve(count);
+			u.reserve(count);
+			v.reserve(count);
+		}
+	};
+
+	void sampleWind(double now, const WindField &wind)
+	{
+		windSamples.x.clear();
+		windSamples.y.clear();
+		for (IntrusiveQueue<Unit> &group : airborne)
+		{
+			group.forEach([this](Unit &unit)
+			{
+				const Vector2 position = unit.getPosition();
+				windSamples.x.push_back(position.x);
+				windSamples.y.push_back(position.y);
+			});
+		}
+		windSamples.u.resize(windSamples.x.size());
+		windSamples.v.resize(windSamples.x.size());
+		wind.sample(windSamples.x.data(), windSamples.y.data(), windSamples.u.data(), windSamples.v.data(),
+					windSamples.x.size(), now);
+	}
+
+	struct Sleeper
+	{
+		double time;
+		Unit *unit;
+	};
+
+	static bool wakesLater(const Sleeper &left, const Sleeper &right)
+	{
+		return left.time > right.time;
+	}
+
+	static bool isSleepingUntil(const Sleeper &sleeper)
+	{
+		return sleeper.unit->wakeTime == sleeper.time;
+	}
+
+	void suspend(Unit *unit, Await await)
+	{
+		switch (await.kind)
+		{
+		case Await::Until:
+			if (sleeping.size() == sleeping.capacity())
+				dropStaleSleepers();
+			sleeping.push_back(Sleeper{ await.time, unit });
+			std::push_heap(sleeping.begin(), sleeping.end(), wakesLater);
+			unit->wakeTime = await.time;
+			++sleepingUnits;
+			break;
+		case Await::Done:
+			ready.pushBack(unit);
+			break;
+		default:
+			fly(unit);
+			break;
+		}
+	}
+
+	// at most one entry per aircraft is live, so this leaves at least half of the reserved room free
+	void dropStaleSleepers()
+	{
+		sleeping.erase(std::remove_if(sleeping.begin(), sleeping.end(), [](const Sleeper &sleeper) { return !isSleepingUntil(sleeper); }),
+					   sleeping.end());
+		std::make_heap(sleeping.begin(), sleeping.end(), wakesLater);
+	}
+
+	// resumed every frame from now on, in the group of its state
+	void fly(Unit *unit)
+	{
+		airborne[static_cast<size_t>(unit->getState())].pushBack(unit);
+	}
+
+	void wakeUp(Unit *unit)
+	{
+		// its heap entry goes stale and is dropped when it comes up
+		if (unit->wakeTime == SortieLink::NOT_SLEEPING)
+			return;
+		unit->wakeTime = SortieLink::NOT_SLEEPING;
+		--sleepingUnits;
+		fly(unit);
+	}
+
+	std::vector<AicraftPtr<FlightModel>> aicrafts;
+	IntrusiveQueue<Unit> ready;
+	// indexed by state
+	IntrusiveQueue<Unit> airborne[AICRAFT_STATES_COUNT];
+	IntrusiveQueue<Unit> regrouped;
+	std::vector<Sleeper> sleeping;
+	size_t sleepingUnits = 0;
+	// the last aircraft launched on its own
+	Unit *leader = nullptr;
+	WindSamples windSamples;
+};
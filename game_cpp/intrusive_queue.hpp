@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+
+
+//-------------------------------------------------------
+//	Intrusive doubly linked queue
+//	elements keep their own links, so moving an element
+//	between queues is O(1) and never allocates
+//-------------------------------------------------------
+
+struct QueueLink
+{
+	QueueLink *prev = nullptr;
+	QueueLink *next = nullptr;
+	bool linked = false;
+};
+
+
+// T is expected to derive from QueueLink, an element is in at most one queue at a time
+template<class T>
+class IntrusiveQueue
+{
+public:
+	IntrusiveQueue() = default;
+	IntrusiveQueue(const IntrusiveQueue&) = delete;
+	IntrusiveQueue& operator=(const IntrusiveQueue&) = delete;
+
+	bool empty() const { return !head; }
+	size_t size() const { return count; }
+	T* front() const { return static_cast<T*>(head); }
+
+	void pushBack(T *element)
+	{
+		QueueLink *link = element;
+		assert(!link->linked);
+		link->prev = tail;
+		link->next = nullptr;
+		link->linked = true;
+		if (tail)
+			tail->next = link;
+		else
+			head = link;
+		tail = link;
+		++count;
+	}
+
+	T* popFront()
+	{
+		T *element = front();
+		if (element)
+			remove(element);
+		return element;
+	}
+
+	void remove(T *element)
+	{
+		QueueLink *link = element;
+		assert(link->linked);
+		if (link->prev)
+			link->prev->next = link->next;
+		else
+			head = link->next;
+		if (link->next)
+			link->next->prev = link->prev;
+		else
+			tail = link->prev;
+		link->prev = nullptr;
+		link->next = nullptr;
+		link->linked = false;
+		--count;
+	}
+
+	// func may remove the current element from this queue
+	template<class Func>
+	void forEach(Func func)
+	{
+		QueueLink *link = head;
+		while (link)
+		{
+			QueueLink *next = link->next;
+			func(*static_cast<T*>(link));
+			link = next;
+		}
+	}
+
+	void clear()
+	{
+		while (head)
+			popFront();
+	}
+
+private:
+	QueueLink *head = nullptr;
+	QueueLink *tail = nullptr;
+	size_t count = 0;
+};
@@ -1,10 +1,37 @@
 
 
+#include <cstdlib>
+#include <cstring>
+
 #include "../framework/engine.hpp"
+#include "flight_recorder.hpp"
 
 
-int main()
+int main(int argc, char *argv[])
 {
-	engine::run();
-	return 0;
+	engine::Options options;
+	// checks run headless, without a window; trajectories are checked by the tests, see tests/main.cpp
+	const char *dumpPath = nullptr;
+	bool checkRender = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--alloc-test") == 0)
+			options.allocationTest = true;
+		else if (strcmp(argv[i], "--alloc-test-recording") == 0 && i + 1 < argc)
+			options.allocationTestRecording = argv[++i];
+		else if (strcmp(argv[i], "--cpu-render") == 0)
+			options.cpuRender = true;
+		else if (strcmp(argv[i], "--check-render") == 0)
+			checkRender = true;
+		else if (strcmp(argv[i], "--frame-budget") == 0 && i + 1 < argc)
+			options.frameBudgetMs = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--dump-flights") == 0 && i + 1 < argc)
+			dumpPath = argv[++i];
+	}
+
+	if (dumpPath)
+		return flight_recorder::dump(dumpPath);
+	if (checkRender)
+		return engine::checkRender();
+	return engine::run(options);
 }
@@ -0,0 +1,255 @@
+#include "navigation.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "../framework/game.hpp"
+#include "../framework/scene.hpp"
+
+namespace
+{
+	constexpr int SIZE = FlowField::SIZE;
+	// the window moves when the goal comes this close to its border
+	constexpr int RECENTER_BORDER = SIZE / 4;
+	// the way is followed this far to get its direction, smooths the eight directions of the grid
+	constexpr int LOOKAHEAD_CELLS = 4;
+	// the waypoint is put far along that direction, out of the turn circle of the slowest aircraft,
+	// so steering turns to the heading of the way instead of circling around a point next to it
+	constexpr float WAYPOINT_DISTANCE = 10.f;
+	constexpr float UNREACHABLE = std::numeric_limits<float>::infinity();
+
+	constexpr int NEIGHBOURS = 8;
+	constexpr uint8_t NO_NEXT = NEIGHBOURS;
+	// straight ones first, diagonal ones are checked against both straight ones they pass between
+	constexpr int NEIGHBOUR_X[NEIGHBOURS] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+	constexpr int NEIGHBOUR_Y[NEIGHBOURS] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+	constexpr float NEIGHBOUR_COST[NEIGHBOURS] = { 1.f, 1.f, 1.f, 1.f, 1.41421356f, 1.41421356f, 1.41421356f, 1.41421356f };
+
+	inline bool isInWindow(int x, int y)
+	{
+		return x >= 0 && x < SIZE && y >= 0 && y < SIZE;
+	}
+
+	// no corner cutting: a diagonal step needs both cells beside it to be free
+	inline bool canStep(const std::vector<uint8_t> &blocked, int x, int y, int direction)
+	{
+		const int toX = x + NEIGHBOUR_X[direction];
+		const int toY = y + NEIGHBOUR_Y[direction];
+		if (!isInWindow(toX, toY))
+			return false;
+		if (direction < 4)
+			return true;
+		return !blocked[toX + y * SIZE] && !blocked[x + toY * SIZE];
+	}
+}
+
+
+//-------------------------------------------------------
+//	NavigationMap
+//-------------------------------------------------------
+
+void NavigationMap::init(unsigned seed)
+{
+	assert(islands.empty());
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> direction(0.f, 2.f * math::PI);
+	std::uniform_real_distribution<float> distance(params::navigation::ISLANDS_MIN_DISTANCE, params::navigation::ISLANDS_MAX_DISTANCE);
+	std::uniform_real_distribution<float> radius(params::navigation::ISLAND_MIN_RADIUS, params::navigation::ISLAND_MAX_RADIUS);
+
+	islands.reserve(params::navigation::ISLANDS_COUNT);
+	for (int i = 0; i < params::navigation::ISLANDS_COUNT; ++i)
+	{
+		const float angle = direction(random);
+		const float range = distance(random);
+		const Island island = { Vector2(range * std::cos(angle), range * std::sin(angle)), radius(random) };
+		islands.push_back(island);
+		scene::addIsland(island.center.x, island.center.y, island.radius);
+	}
+}
+
+
+void NavigationMap::deinit()
+{
+	islands.clear();
+	scene::clearIslands();
+}
+
+
+int NavigationMap::cellCoord(float value)
+{
+	return static_cast<int>(std::floor(value / params::navigation::CELL_SIZE));
+}
+
+
+void NavigationMap::rasterize(int originX, int originY, int size, std::vector<uint8_t> &blocked) const
+{
+	const float cellSize = params::navigation::CELL_SIZE;
+	blocked.assign(size * size, 0);
+	for (const Island &island : islands)
+	{
+		const float reach = island.radius + params::navigation::SHORE_MARGIN;
+		const int fromX = std::max(cellCoord(island.center.x - reach) - originX, 0);
+		const int toX = std::min(cellCoord(island.center.x + reach) - originX, size - 1);
+		const int fromY = std::max(cellCoord(island.center.y - reach) - originY, 0);
+		const int toY = std::min(cellCoord(island.center.y + reach) - originY, size - 1);
+		for (int y = fromY; y <= toY; ++y)
+		{
+			for (int x = fromX; x <= toX; ++x)
+			{
+				const Vector2 center((originX + x + 0.5f) * cellSize, (originY + y + 0.5f) * cellSize);
+				if ((center - island.center).length() < reach)
+					blocked[x + y * size] = 1;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	FlowField
+//-------------------------------------------------------
+
+void FlowField::update(Vector2 newGoal, const NavigationMap &map)
+{
+	goal = newGoal;
+	const int cellX = NavigationMap::cellCoord(goal.x);
+	const int cellY = NavigationMap::cellCoord(goal.y);
+	if (valid && cellX == goalX && cellY == goalY)
+		return;
+
+	goalX = cellX;
+	goalY = cellY;
+	const int x = goalX - originX;
+	const int y = goalY - originY;
+	if (!valid || x < RECENTER_BORDER || x >= SIZE - RECENTER_BORDER || y < RECENTER_BORDER || y >= SIZE - RECENTER_BORDER)
+		recenter(cellX, cellY, map);
+
+	searchDistances();
+	linkCells();
+	valid = true;
+	++rebuilds;
+}
+
+
+Vector2 FlowField::waypoint(Vector2 position) const
+{
+	int index = windowIndex(position);
+	if (index < 0)
+		return goal;
+
+	for (int step = 0; step < LOOKAHEAD_CELLS; ++step)
+	{
+		// the goal cell and cells with no way out have no next one
+		const uint8_t direction = next[index];
+		if (direction == NO_NEXT)
+			return goal;
+		index += NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * SIZE;
+	}
+	const Vector2 ahead = cellCenter(index) - position;
+	return position + (WAYPOINT_DISTANCE / ahead.length()) * ahead;
+}
+
+
+float FlowField::pathLength(Vector2 position) const
+{
+	const float straight = (goal - position).length();
+	const int index = windowIndex(position);
+	if (index < 0 || distance[index] == UNREACHABLE)
+		return straight;
+	return std::max(straight, distance[index] * params::navigation::CELL_SIZE);
+}
+
+
+int FlowField::windowIndex(Vector2 position) const
+{
+	if (!valid)
+		return -1;
+	const int x = NavigationMap::cellCoord(position.x) - originX;
+	const int y = NavigationMap::cellCoord(position.y) - originY;
+	return isInWindow(x, y) ? x + y * SIZE : -1;
+}
+
+
+Vector2 FlowField::cellCenter(int index) const
+{
+	const float cellSize = params::navigation::CELL_SIZE;
+	return Vector2((originX + index % SIZE + 0.5f) * cellSize, (originY + index / SIZE + 0.5f) * cellSize);
+}
+
+
+void FlowField::recenter(int cellX, int cellY, const NavigationMap &map)
+{
+	originX = cellX - SIZE / 2;
+	originY = cellY - SIZE / 2;
+	map.rasterize(originX, originY, SIZE, blocked);
+	distance.resize(SIZE * SIZE);
+	next.resize(SIZE * SIZE);
+	// lazy deletion leaves stale nodes in the heap, a cell is pushed at most once per neighbour
+	open.reserve(SIZE * SIZE);
+}
+
+
+void FlowField::searchDistances()
+{
+	std::fill(distance.begin(), distance.end(), UNREACHABLE);
+	open.clear();
+
+	// the carrier may sail close to the shore, its own cell is always a start
+	const int start = (goalX - originX) + (goalY - originY) * SIZE;
+	distance[start] = 0.f;
+	open.push_back(Node{ 0.f, start });
+
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), isFartherNode);
+		const Node node = open.back();
+		open.pop_back();
+		if (node.distance > distance[node.index])
+			continue;
+
+		const int x = node.index % SIZE;
+		const int y = node.index / SIZE;
+		for (int direction = 0; direction < NEIGHBOURS; ++direction)
+		{
+			if (!canStep(blocked, x, y, direction))
+				continue;
+			const int neighbour = node.index + NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * SIZE;
+			const float neighbourDistance = node.distance + NEIGHBOUR_COST[direction];
+			if (blocked[neighbour] || neighbourDistance >= distance[neighbour])
+				continue;
+			distance[neighbour] = neighbourDistance;
+			open.push_back(Node{ neighbourDistance, neighbour });
+			std::push_heap(open.begin(), open.end(), isFartherNode);
+		}
+	}
+}
+
+
+void FlowField::linkCells()
+{
+	for (int y = 0; y < SIZE; ++y)
+	{
+		for (int x = 0; x < SIZE; ++x)
+		{
+			const int index = x + y * SIZE;
+			// aircrafts over an island are led to the nearest reachable water
+			float best = blocked[index] ? UNREACHABLE : distance[index];
+			uint8_t bestDirection = NO_NEXT;
+			for (int direction = 0; direction < NEIGHBOURS; ++direction)
+			{
+				if (!canStep(blocked, x, y, direction))
+					continue;
+				const int neighbour = index + NEIGHBOUR_X[direction] + NEIGHBOUR_Y[direction] * SIZE;
+				if (distance[neighbour] < best)
+				{
+					best = distance[neighbour];
+					bestDirection = static_cast<uint8_t>(direction);
+				}
+			}
+			next[index] = bestDirection;
+		}
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Navigation around islands
+//	islands are shared by the world, every carrier keeps a flow field towards itself,
+//	so the path search is paid per carrier and aircrafts only look the way up
+//-------------------------------------------------------
+
+struct Island
+{
+	Vector2 center;
+	float radius;
+};
+
+
+class NavigationMap
+{
+public:
+	// scatters islands around the start and shows them in the scene
+	void init(unsigned seed);
+	void deinit();
+
+	const std::vector<Island>& getIslands() const { return islands; }
+
+	// cell of a world coordinate, cells are params::navigation::CELL_SIZE wide
+	static int cellCoord(float value);
+	// sets blocked[x + y * size] for every cell of the window which is too close to an island
+	void rasterize(int originX, int originY, int size, std::vector<uint8_t> &blocked) const;
+
+private:
+	std::vector<Island> islands;
+};
+
+
+// Shortest way to one goal from every cell of a square window around it.
+// The window is recentered only when the goal nears its border, distances are
+// searched again only when the goal moves to another cell.
+class FlowField
+{
+public:
+	static constexpr int SIZE = 128;
+
+	void update(Vector2 goal, const NavigationMap &map);
+
+	// point to steer at from the position: far along the way ahead, or the goal itself
+	// when it is close, out of the window or not reachable
+	Vector2 waypoint(Vector2 position) const;
+	// length of the way to the goal, never less than the straight distance
+	float pathLength(Vector2 position) const;
+
+	unsigned getRebuildsCount() const { return rebuilds; }
+
+private:
+	struct Node
+	{
+		float distance;
+		int index;
+	};
+
+	static bool isFartherNode(const Node &left, const Node &right) { return left.distance > right.distance; }
+
+	int windowIndex(Vector2 position) const;
+	Vector2 cellCenter(int index) const;
+	void recenter(int cellX, int cellY, const NavigationMap &map);
+	void searchDistances();
+	void linkCells();
+
+	Vector2 goal;
+	int goalX = 0;
+	int goalY = 0;
+	int originX = 0;
+	int originY = 0;
+	bool valid = false;
+	unsigned rebuilds = 0;
+
+	std::vector<uint8_t> blocked;
+	// in cells, infinity where the goal can not be reached
+	std::vector<float> distance;
+	// direction to the next cell of the way, one of NEIGHBOURS or NO_NEXT
+	std::vector<uint8_t> next;
+	std::vector<Node> open;
+};
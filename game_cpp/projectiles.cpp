@@ -0,0 +1,234 @@
+#include "projectiles.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../framework/game.hpp"
+#include "../framework/scene.hpp"
+
+namespace
+{
+	constexpr float CELL_SIZE = 1.f;
+	// cells are hashed into a square which wraps around, far bodies may share a cell
+	constexpr int GRID_SIZE = 64;
+	constexpr int GRID_MASK = GRID_SIZE - 1;
+	constexpr size_t CELLS = GRID_SIZE * GRID_SIZE;
+	constexpr size_t CELL_BODIES_RESERVE = 1024;
+	constexpr size_t TARGETS_RESERVE = 16;
+
+	static_assert((GRID_SIZE & GRID_MASK) == 0, "grid size is expected to be a power of two");
+
+	inline int cellCoord(float value)
+	{
+		return static_cast<int>(std::floor(value / CELL_SIZE));
+	}
+
+	inline size_t cellIndex(int cellX, int cellY)
+	{
+		return static_cast<size_t>((cellY & GRID_MASK) * GRID_SIZE + (cellX & GRID_MASK));
+	}
+
+	// calls func(cell) for every cell of the box, each hashed cell once even if the box is wider than the grid
+	template<class Func>
+	void forEachCell(float left, float bottom, float right, float top, Func func)
+	{
+		const int fromX = cellCoord(left);
+		const int fromY = cellCoord(bottom);
+		const int toX = std::min(cellCoord(right), fromX + GRID_MASK);
+		const int toY = std::min(cellCoord(top), fromY + GRID_MASK);
+		for (int cellY = fromY; cellY <= toY; ++cellY)
+		{
+			for (int cellX = fromX; cellX <= toX; ++cellX)
+				func(cellIndex(cellX, cellY));
+		}
+	}
+
+	bool segmentHitsCircle(Vector2 from, Vector2 to, Vector2 center, float radius)
+	{
+		const Vector2 direction = to - from;
+		const float lengthSquared = direction.lengthSquared();
+		float t = lengthSquared > 0.f ? dot(center - from, direction) / lengthSquared : 0.f;
+		t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t);
+		return (from + t * direction - center).lengthSquared() <= radius * radius;
+	}
+}
+
+
+void Projectiles::init(const NavigationMap &map, int ownersCount)
+{
+	x.reserve(CAPACITY);
+	y.reserve(CAPACITY);
+	vx.reserve(CAPACITY);
+	vy.reserve(CAPACITY);
+	deathTime.reserve(CAPACITY);
+	nextX.reserve(CAPACITY);
+	nextY.reserve(CAPACITY);
+
+	bodies.clear();
+	for (const Island &island : map.getIslands())
+		bodies.push_back(Body{ island.center, island.radius, -1 });
+	staticBodies = bodies.size();
+	bodies.reserve(staticBodies + TARGETS_RESERVE);
+	hits.assign(ownersCount, 0);
+
+	cellStart.resize(CELLS + 1);
+	cellBodies.reserve(CELL_BODIES_RESERVE);
+	clear();
+}
+
+
+void Projectiles::clear()
+{
+	x.clear();
+	y.clear();
+	vx.clear();
+	vy.clear();
+	deathTime.clear();
+	clearTargets();
+}
+
+
+bool Projectiles::fire(Vector2 position, Vector2 velocity, float life)
+{
+	if (x.size() == CAPACITY)
+	{
+		++dropped;
+		return false;
+	}
+	x.push_back(position.x);
+	y.push_back(position.y);
+	vx.push_back(velocity.x);
+	vy.push_back(velocity.y);
+	deathTime.push_back(time + life);
+	return true;
+}
+
+
+void Projectiles::clearTargets()
+{
+	bodies.resize(staticBodies);
+}
+
+
+void Projectiles::addTarget(Vector2 center, float radius, int owner)
+{
+	assert(owner >= 0 && owner < static_cast<int>(hits.size()));
+	bodies.push_back(Body{ center, radius, owner });
+}
+
+
+void Projectiles::update(float dt)
+{
+	time += dt;
+	advance(dt);
+	buildGrid();
+
+	size_t i = 0;
+	while (i < x.size())
+	{
+		if (deathTime[i] <= time)
+		{
+			remove(i);
+			continue;
+		}
+
+		const Vector2 from(x[i], y[i]);
+		const Vector2 to(nextX[i], nextY[i]);
+		if (const Body *body = sweep(from, to))
+		{
+			if (body->owner >= 0)
+				++hits[body->owner];
+			scene::addFlash(to.x, to.y);
+			remove(i);
+			continue;
+		}
+		x[i] = to.x;
+		y[i] = to.y;
+		++i;
+	}
+
+	scene::submitTracers(x.data(), y.data(), vx.data(), vy.data(), x.size());
+}
+
+
+void Projectiles::remove(size_t index)
+{
+	x[index] = x.back();
+	y[index] = y.back();
+	vx[index] = vx.back();
+	vy[index] = vy.back();
+	deathTime[index] = deathTime.back();
+	nextX[index] = nextX.back();
+	nextY[index] = nextY.back();
+	x.pop_back();
+	y.pop_back();
+	vx.pop_back();
+	vy.pop_back();
+	deathTime.pop_back();
+	nextX.pop_back();
+	nextY.pop_back();
+}
+
+
+void Projectiles::advance(float dt)
+{
+	const size_t count = x.size();
+	nextX.resize(count);
+	nextY.resize(count);
+	size_t i = 0;
+	for (; i + Vector2x8::LANES <= count; i += Vector2x8::LANES)
+	{
+		const Vector2x8 position = Vector2x8::load(&x[i], &y[i]);
+		const Vector2x8 velocity = Vector2x8::load(&vx[i], &vy[i]);
+		(position + dt * velocity).store(&nextX[i], &nextY[i]);
+	}
+	for (; i < count; ++i)
+	{
+		nextX[i] = x[i] + dt * vx[i];
+		nextY[i] = y[i] + dt * vy[i];
+	}
+}
+
+
+// counting sort: count bodies per cell, turn counts into starts, then place bodies
+void Projectiles::buildGrid()
+{
+	std::fill(cellStart.begin(), cellStart.end(), 0);
+	for (const Body &body : bodies)
+	{
+		forEachCell(body.center.x - body.radius, body.center.y - body.radius, body.center.x + body.radius, body.center.y + body.radius,
+					[this](size_t cell) { ++cellStart[cell + 1]; });
+	}
+	for (size_t cell = 0; cell < CELLS; ++cell)
+		cellStart[cell + 1] += cellStart[cell];
+
+	cellBodies.resize(cellStart[CELLS]);
+	for (uint32_t index = 0; index < bodies.size(); ++index)
+	{
+		const Body &body = bodies[index];
+		forEachCell(body.center.x - body.radius, body.center.y - body.radius, body.center.x + body.radius, body.center.y + body.radius,
+					[this, index](size_t cell) { cellBodies[cellStart[cell]++] = index; });
+	}
+	// placing moved every start to the start of the next cell
+	for (size_t cell = CELLS; cell > 0; --cell)
+		cellStart[cell] = cellStart[cell - 1];
+	cellStart[0] = 0;
+}
+
+
+const Projectiles::Body* Projectiles::sweep(Vector2 from, Vector2 to) const
+{
+	const Body *hit = nullptr;
+	forEachCell(std::min(from.x, to.x), std::min(from.y, to.y), std::max(from.x, to.x), std::max(from.y, to.y),
+				[this, from, to, &hit](size_t cell)
+	{
+		for (uint32_t entry = cellStart[cell]; !hit && entry < cellStart[cell + 1]; ++entry)
+		{
+			const Body &body = bodies[cellBodies[entry]];
+			if (segmentHitsCircle(from, to, body.center, body.radius))
+				hit = &body;
+		}
+	});
+	return hit;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "navigation.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Projectiles of all carriers
+//	rounds live in a fixed capacity pool, one array per field, dead ones are
+//	swapped with the last live one. Every step is swept against bodies
+//	bucketed into a grid: islands which stop rounds and strike targets.
+//-------------------------------------------------------
+
+class Projectiles
+{
+public:
+	static constexpr size_t CAPACITY = 4096;
+
+	// islands are static bodies, owners are the carriers strike targets are registered for
+	void init(const NavigationMap &map, int ownersCount);
+	void clear();
+
+	// false if the pool is full and the round is dropped
+	bool fire(Vector2 position, Vector2 velocity, float life);
+
+	// strike targets are registered anew every step, before update
+	void clearTargets();
+	void addTarget(Vector2 center, float radius, int owner);
+
+	// moves rounds, removes expired ones and ones which hit a body, draws the rest
+	void update(float dt);
+
+	size_t size() const { return x.size(); }
+	uint32_t getHits(int owner) const { return hits[owner]; }
+	uint64_t getDropped() const { return dropped; }
+
+private:
+	struct Body
+	{
+		Vector2 center;
+		float radius;
+		// -1 for islands
+		int owner;
+	};
+
+	void remove(size_t index);
+	void advance(float dt);
+	void buildGrid();
+	const Body* sweep(Vector2 from, Vector2 to) const;
+
+	// live rounds
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> vx;
+	std::vector<float> vy;
+	std::vector<float> deathTime;
+	// where rounds are at the end of the step, before hits are tested
+	std::vector<float> nextX;
+	std::vector<float> nextY;
+	float time = 0;
+	uint64_t dropped = 0;
+
+	std::vector<Body> bodies;
+	size_t staticBodies = 0;
+	std::vector<uint32_t> hits;
+
+	// bodies sorted by cell, cellStart[cell]..cellStart[cell + 1] index into cellBodies
+	std::vector<uint32_t> cellStart;
+	std::vector<uint32_t> cellBodies;
+};
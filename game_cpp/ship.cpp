@@ -3,37 +3,61 @@
 #include <cassert>
 #include <cmath>
 
+namespace
+{
+	constexpr float DECK_FRONT = 0.4f;
+}
+
 Ship::Ship() :
 	mesh(nullptr)
 {
 }
 
-void Ship::init()
+void Ship::init(Vector2 startPosition, float startAngle, Projectiles *worldProjectiles, const WingLayout &wing)
 {
 	assert(!mesh);
+	// stream ids of a carrier have room for this many side numbers
+	assert(wing.fighters + wing.tankers + wing.awacs <= params::ship::AICRAFTS_COUNT);
+	projectiles = worldProjectiles;
 	mesh = scene::createShipMesh();
-	position = Vector2(0.f, 0.f);
-	angle = 0.f;
-	aicrafts = std::list<AicraftPtr>(5);
+	scene::setMeshOwner(mesh, this);
+	position = startPosition;
+	previousPosition = position;
+	angle = startAngle;
+	time = 0;
+	targetIsSet = false;
+	aicrafts.clear();
 	int sideNumber = 0;
-	for (auto& craft: aicrafts)
+	addAicrafts<flight_model::Fighter>(wing.fighters, sideNumber);
+	addAicrafts<flight_model::Tanker>(wing.tankers, sideNumber);
+	addAicrafts<flight_model::Awacs>(wing.awacs, sideNumber);
+	releaseKeys();
+	scene::placeMesh(mesh, position.x, position.y, angle);
+}
+
+
+template<class FlightModel>
+void Ship::addAicrafts(int count, int &sideNumber)
+{
+	auto &squadron = aicrafts.squadron<FlightModel>();
+	for (int i = 0; i < count; ++i)
 	{
-		craft = std::make_unique<Aicraft>();
-		craft->init(this, ++sideNumber);
+		auto aicraft = std::make_unique<Aicraft<FlightModel>>();
+		aicraft->init(this, ++sideNumber);
+		squadron.add(std::move(aicraft));
 	}
-	for (bool &key : input)
-		key = false;
 }
 
 
 void Ship::deinit()
 {
+	aicrafts.clear();
 	scene::destroyMesh(mesh);
 	mesh = nullptr;
 }
 
 
-void Ship::update(float dt)
+void Ship::updateMotion(float dt)
 {
 	linearSpeed = 0.f;
 	angularSpeed = 0.f;
@@ -56,11 +80,11 @@ void Ship::update(float dt)
 		angularSpeed = -params::ship::ANGULAR_SPEED;
 	}
 
+	time += dt;
+	previousPosition = position;
 	angle = angle + angularSpeed * dt;
-	position = position + linearSpeed * dt * Vector2(std::cos(angle), std::sin(angle));
+	position = position + linearSpeed * dt * Vector2::fromAngle(angle);
 	scene::placeMesh(mesh, position.x, position.y, angle);
-	for(auto& aicraft : aicrafts)
-		aicraft->update(dt);
 }
 
 
@@ -78,43 +102,48 @@ void Ship::keyReleased(int key)
 }
 
 
-void Ship::mouseClicked(Vector2 worldPosition, bool isLeftButton)
+void Ship::releaseKeys()
 {
-	// TODO: placeholder, remove it and implement aircarfts logic
-	if (isLeftButton)
-	{
-		scene::placeGoalMarker(worldPosition.x, worldPosition.y);
-		for (auto& aicraft : aicrafts)
-			aicraft->newTarget(worldPosition);
-	}
-	else
-	{
-		tryLaunchAicraft();
-	}
+	for (bool &key : input)
+		key = false;
+}
+
+
+void Ship::setTarget(Vector2 worldPosition)
+{
+	target = worldPosition;
+	targetIsSet = true;
+	aicrafts.newTarget(worldPosition);
 }
 
 Vector2 Ship::localToGlobal(float localPosition) const
 {
-	Vector2 shipDirection(cosf(angle), sinf(angle));
+	Vector2 shipDirection = Vector2::fromAngle(angle);
 	return position + localPosition*shipDirection;
 }
 
-bool Ship::isOnShip(float localPosition) const
+float Ship::getDeckFront() const
 {
-	constexpr float shipFront = 0.4f;
-	return localPosition <= shipFront;
+	return DECK_FRONT;
 }
 
 void Ship::tryLaunchAicraft()
 {
-	if (! (aicrafts.front()->getState() == AicraftState::Ready))
+	if (!aicrafts.launch())
 	{
 		game::log(game::LOG_INFO, "There are no ready aicrafts");
-		return;
 	}
+}
 
-	auto craft = std::move(aicrafts.front());
-	aicrafts.pop_front();
-	aicrafts.push_back(std::move(craft));
-	aicrafts.back()->launch();
+void Ship::collectPoses(WorldSnapshot &snapshot, uint16_t idBase) const
+{
+	snapshot.entities.push_back(EntityPose{ idBase, EntityKind::Ship, AicraftState::NotReady, position.x, position.y, angle,
+		linearSpeed, angularSpeed });
+	// side numbers are unique and assigned squadron by squadron, so ids come out sorted
+	aicrafts.forEach([&snapshot, idBase](const auto &aicraft)
+	{
+		const Vector2 position = aicraft.getPosition();
+		snapshot.entities.push_back(EntityPose{ static_cast<uint16_t>(idBase + aicraft.getNumber()), EntityKind::Aicraft,
+			aicraft.getState(), position.x, position.y, aicraft.getAngle(), aicraft.getSpeed(), aicraft.getAngularSpeed() });
+	});
 }
@@ -2,48 +2,86 @@
 
 #include "../framework/scene.hpp"
 #include "../framework/game.hpp"
-#include "aircraft.hpp"
+#include "air_wing.hpp"
+#include "navigation.hpp"
+#include "projectiles.hpp"
+#include "world_stream.hpp"
 #include "utils.hpp"
 
-#include <list>
-
-
 
 //-------------------------------------------------------
 //	Simple ship logic
 //-------------------------------------------------------
 
+typedef AirWing<flight_model::Fighter, flight_model::Tanker, flight_model::Awacs> ShipAirWing;
+
+// aircrafts of every model a carrier takes on board, side numbers go fighters first
+struct WingLayout
+{
+	int fighters = params::ship::AICRAFTS_COUNT;
+	int tankers = 0;
+	int awacs = 0;
+};
+
 class Ship
 {
 public:
 	Ship();
 
-	void init();
+	// rounds fired by the air wing go to the shared projectiles
+	void init(Vector2 startPosition, float startAngle, Projectiles *worldProjectiles, const WingLayout &wing = WingLayout());
 	void deinit();
-	void update(float dt);
+	// moves the hull only, aircrafts are updated by the world in per-model passes
+	void updateMotion(float dt);
+	// searches the way home again only after the hull moved to another cell
+	void updateFlowField(const NavigationMap &map) { flowField.update(position, map); }
 	void keyPressed(int key);
 	void keyReleased(int key);
-	void mouseClicked(Vector2 worldPosition, bool isLeftButton);
+	void releaseKeys();
+	void setTarget(Vector2 worldPosition);
+	void tryLaunchAicraft();
+	void recallAicraft(AicraftBase *aicraft) { aicrafts.recall(aicraft); }
+
+	ShipAirWing& getAicrafts() { return aicrafts; }
+	bool hasTarget() const { return targetIsSet; }
+	const Vector2& getTarget() const { return target; }
+	const FlowField& getFlowField() const { return flowField; }
+	Projectiles& getProjectiles() { return *projectiles; }
+	// aircrafts on the deck are attached to it
+	scene::Mesh* getMesh() const { return mesh; }
 
 	const Vector2& getPosition() const { return position; }
+	// position before the last update, aircrafts use it for swept tests
+	const Vector2& getPreviousPosition() const { return previousPosition; }
 	float getAngle() const { return angle; }
 	float getSpeed() const { return linearSpeed; }
 	float getAngularSpeed() const { return angularSpeed; }
+	double getTime() const { return time; }
 
 	Vector2 localToGlobal(float localPosition) const;
-	bool isOnShip(float localPosition) const;
+	float getDeckFront() const;
+
+	// ship gets idBase, its aircrafts idBase + side number
+	void collectPoses(WorldSnapshot &snapshot, uint16_t idBase) const;
 
 protected:
-	void tryLaunchAicraft();
+	template<class FlightModel>
+	void addAicrafts(int count, int &sideNumber);
 
 private:
 	scene::Mesh *mesh = nullptr;
 	Vector2 position;
+	Vector2 previousPosition;
 	float angle = 0;
 	float linearSpeed = 0;
 	float angularSpeed = 0;
+	double time = 0;
+	Vector2 target;
+	bool targetIsSet = false;
 
 	bool input[game::KEY_COUNT];
 
-	std::list<AicraftPtr> aicrafts;
+	ShipAirWing aicrafts;
+	FlowField flowField;
+	Projectiles *projectiles = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "intrusive_queue.hpp"
+
+
+//-------------------------------------------------------
+//	Resumable sorties
+//	a sortie is a stackless routine: it returns what it waits for and
+//	continues from the same point when its scheduler resumes it, so a
+//	suspended aircraft costs nothing until then.
+//	Locals do not survive a suspension, keep state in members.
+//-------------------------------------------------------
+
+struct Await
+{
+	enum Kind
+	{
+		NextFrame,
+		Until,
+		Done
+	};
+
+	Kind kind;
+	// simulation time for Until
+	double time;
+
+	static Await nextFrame() { return Await{ NextFrame, 0.0 }; }
+	static Await until(double time) { return Await{ Until, time }; }
+	static Await done() { return Await{ Done, 0.0 }; }
+};
+
+
+// scheduler bookkeeping kept in the aircraft: a queue link while it is
+// resumed every frame, the time it sleeps until otherwise
+struct SortieLink : QueueLink
+{
+	static constexpr double NOT_SLEEPING = -1.0;
+	double wakeTime = NOT_SLEEPING;
+	// the scheduler which owns the link, an aircraft found by other means is handed to it without a search
+	const void *scheduler = nullptr;
+};
+
+
+// resume point of a routine, zero is its beginning
+typedef int ResumePoint;
+
+// __COUNTER__ and not __LINE__, the latter is not a constant with edit and continue
+#define SORTIE_BEGIN(point) switch (point) { case 0:
+#define SORTIE_AWAIT(point, awaitable) SORTIE_AWAIT_AT(point, awaitable, __COUNTER__ + 1)
+#define SORTIE_AWAIT_AT(point, awaitable, label) \
+	do { point = label; return (awaitable); case label:; } while (false)
+#define SORTIE_END(point) } point = 0; return Await::done();
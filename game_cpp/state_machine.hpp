@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+
+
+//-------------------------------------------------------
+//	Table driven state machine
+//	transitions are listed as a table which is turned into a [state][event]
+//	jump table at compile time. The table is meant to be checked with
+//	static_assert: no transition listed twice or out of range, every state
+//	reachable from the initial one and every state can be left.
+//-------------------------------------------------------
+
+template<class State, class Event, class Context>
+struct Transition
+{
+	typedef bool (*Guard)(const Context &context);
+
+	State from;
+	Event event;
+	State to;
+	// nullptr if the transition is always taken
+	Guard guard;
+};
+
+
+// State and Event are enums with values from 0 to count - 1
+template<class State, size_t StatesCount, class Event, size_t EventsCount, class Context>
+class StateMachine
+{
+public:
+	typedef Transition<State, Event, Context> TransitionType;
+	typedef typename TransitionType::Guard Guard;
+
+	template<size_t TransitionsCount>
+	constexpr StateMachine(const TransitionType (&transitions)[TransitionsCount], State initialState) :
+		cells{},
+		initial(index(initialState)),
+		malformed(0)
+	{
+		for (size_t state = 0; state < StatesCount; ++state)
+		{
+			for (size_t event = 0; event < EventsCount; ++event)
+				cells[state][event] = Cell{ NONE, nullptr };
+		}
+		for (const TransitionType &transition : transitions)
+		{
+			const size_t from = index(transition.from);
+			const size_t event = index(transition.event);
+			const size_t to = index(transition.to);
+			if (from >= StatesCount || event >= EventsCount || to >= StatesCount || cells[from][event].to != NONE)
+				++malformed;
+			else
+				cells[from][event] = Cell{ to, transition.guard };
+		}
+	}
+
+	// false if there is no transition for the event or its guard does not pass
+	constexpr bool accepts(State from, Event event, const Context &context) const
+	{
+		const Cell &cell = cells[index(from)][index(event)];
+		return cell.to != NONE && (!cell.guard || cell.guard(context));
+	}
+
+	// the event is expected to be accepted
+	constexpr State next(State from, Event event) const
+	{
+		return static_cast<State>(cells[index(from)][index(event)].to);
+	}
+
+	// compile time validation
+	constexpr bool isWellFormed() const { return malformed == 0; }
+
+	constexpr bool isEveryStateReachable() const
+	{
+		bool reached[StatesCount] = {};
+		reached[initial] = true;
+		bool grown = true;
+		while (grown)
+		{
+			grown = false;
+			for (size_t state = 0; state < StatesCount; ++state)
+			{
+				for (size_t event = 0; reached[state] && event < EventsCount; ++event)
+				{
+					const size_t to = cells[state][event].to;
+					if (to != NONE && !reached[to])
+						reached[to] = grown = true;
+				}
+			}
+		}
+		for (size_t state = 0; state < StatesCount; ++state)
+		{
+			if (!reached[state])
+				return false;
+		}
+		return true;
+	}
+
+	constexpr bool hasNoDeadEnds() const
+	{
+		for (size_t state = 0; state < StatesCount; ++state)
+		{
+			bool leaves = false;
+			for (size_t event = 0; event < EventsCount; ++event)
+				leaves = leaves || cells[state][event].to != NONE;
+			if (!leaves)
+				return false;
+		}
+		return true;
+	}
+
+private:
+	static constexpr size_t NONE = StatesCount;
+
+	template<class Enum>
+	static constexpr size_t index(Enum value) { return static_cast<size_t>(value); }
+
+	struct Cell
+	{
+		size_t to;
+		Guard guard;
+	};
+
+	Cell cells[StatesCount][EventsCount];
+	size_t initial;
+	int malformed;
+};
@@ -0,0 +1,173 @@
+#include "stream_transport.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+	constexpr int MAX_DATAGRAM_SIZE = 65507;
+
+	// the few calls where winsock and BSD sockets differ
+#ifdef _WIN32
+	bool startSockets()
+	{
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}
+
+	void stopSockets()
+	{
+		WSACleanup();
+	}
+
+	bool setNonBlocking(SOCKET handle)
+	{
+		u_long nonBlocking = 1;
+		return ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+	}
+#else
+	typedef int SOCKET;
+	constexpr SOCKET INVALID_SOCKET = -1;
+
+	bool startSockets()
+	{
+		return true;
+	}
+
+	void stopSockets()
+	{
+	}
+
+	bool setNonBlocking(SOCKET handle)
+	{
+		const int flags = fcntl(handle, F_GETFL, 0);
+		return flags != -1 && fcntl(handle, F_SETFL, flags | O_NONBLOCK) == 0;
+	}
+
+	int closesocket(SOCKET handle)
+	{
+		return close(handle);
+	}
+#endif
+
+	sockaddr_in loopbackAddress(uint16_t port)
+	{
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return address;
+	}
+}
+
+
+//-------------------------------------------------------
+//	UdpTransport
+//-------------------------------------------------------
+
+UdpTransport::UdpTransport(uint16_t localPort, uint16_t peerPortArg) :
+	socketHandle(static_cast<uintptr_t>(INVALID_SOCKET)),
+	peerPort(peerPortArg),
+	receiveBuffer(MAX_DATAGRAM_SIZE)
+{
+	if (!startSockets())
+		return;
+
+	SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (handle == INVALID_SOCKET)
+		return;
+
+	sockaddr_in address = loopbackAddress(localPort);
+	if (bind(handle, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || !setNonBlocking(handle))
+	{
+		closesocket(handle);
+		return;
+	}
+	socketHandle = static_cast<uintptr_t>(handle);
+}
+
+UdpTransport::~UdpTransport()
+{
+	if (isOpen())
+		closesocket(static_cast<SOCKET>(socketHandle));
+	stopSockets();
+}
+
+bool UdpTransport::isOpen() const
+{
+	return socketHandle != static_cast<uintptr_t>(INVALID_SOCKET);
+}
+
+void UdpTransport::send(const Packet &packet)
+{
+	if (!isOpen() || packet.empty())
+		return;
+
+	sockaddr_in address = loopbackAddress(peerPort);
+	sendto(static_cast<SOCKET>(socketHandle), reinterpret_cast<const char*>(packet.data()), static_cast<int>(packet.size()), 0,
+		   reinterpret_cast<sockaddr*>(&address), sizeof(address));
+}
+
+bool UdpTransport::receive(Packet &packet)
+{
+	if (!isOpen())
+		return false;
+
+	const int size = recvfrom(static_cast<SOCKET>(socketHandle), reinterpret_cast<char*>(receiveBuffer.data()), MAX_DATAGRAM_SIZE, 0, nullptr, nullptr);
+	if (size <= 0)
+	{
+		packet.clear();
+		return false;
+	}
+	packet.assign(receiveBuffer.begin(), receiveBuffer.begin() + size);
+	return true;
+}
+
+
+//-------------------------------------------------------
+//	LoopbackTransport
+//-------------------------------------------------------
+
+std::pair<std::unique_ptr<LoopbackTransport>, std::unique_ptr<LoopbackTransport>> LoopbackTransport::makePair()
+{
+	auto first = std::make_shared<Channel>();
+	auto second = std::make_shared<Channel>();
+	return std::make_pair(std::unique_ptr<LoopbackTransport>(new LoopbackTransport(first, second)),
+						  std::unique_ptr<LoopbackTransport>(new LoopbackTransport(second, first)));
+}
+
+LoopbackTransport::LoopbackTransport(std::shared_ptr<Channel> inArg, std::shared_ptr<Channel> outArg) :
+	in(inArg),
+	out(outArg)
+{
+}
+
+void LoopbackTransport::send(const Packet &packet)
+{
+	std::lock_guard<std::mutex> lock(out->mutex);
+	if (out->count == out->packets.size())
+		return;
+	out->packets[(out->head + out->count) % out->packets.size()].assign(packet.begin(), packet.end());
+	++out->count;
+}
+
+bool LoopbackTransport::receive(Packet &packet)
+{
+	std::lock_guard<std::mutex> lock(in->mutex);
+	if (in->count == 0)
+		return false;
+	packet.swap(in->packets[in->head]);
+	in->head = (in->head + 1) % in->packets.size();
+	--in->count;
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Datagram transports for the world stream
+//-------------------------------------------------------
+
+typedef std::vector<uint8_t> Packet;
+
+class StreamTransport
+{
+public:
+	virtual ~StreamTransport() {}
+
+	virtual void send(const Packet &packet) = 0;
+	// non-blocking, returns false when there is nothing to read
+	virtual bool receive(Packet &packet) = 0;
+};
+
+
+// UDP over 127.0.0.1, publisher binds its own port and sends to the peer port
+class UdpTransport : public StreamTransport
+{
+public:
+	UdpTransport(uint16_t localPort, uint16_t peerPort);
+	~UdpTransport() override;
+
+	bool isOpen() const;
+	void send(const Packet &packet) override;
+	bool receive(Packet &packet) override;
+
+private:
+	uintptr_t socketHandle;
+	uint16_t peerPort;
+	// sized for the largest datagram once, only what arrived is copied out of it
+	Packet receiveBuffer;
+};
+
+
+// In-process stand-in, both ends of a pair share two queues. A queue keeps a bounded number
+// of datagrams like a socket buffer, the ones sent while it is full are dropped; buffers stay
+// in their slots and are swapped with the receiver's, so steady traffic does not allocate
+class LoopbackTransport : public StreamTransport
+{
+public:
+	static constexpr size_t QUEUE_PACKETS = 256;
+
+	static std::pair<std::unique_ptr<LoopbackTransport>, std::unique_ptr<LoopbackTransport>> makePair();
+
+	void send(const Packet &packet) override;
+	bool receive(Packet &packet) override;
+
+private:
+	struct Channel
+	{
+		std::mutex mutex;
+		// packets from head on are waiting
+		std::vector<Packet> packets = std::vector<Packet>(QUEUE_PACKETS);
+		size_t head = 0;
+		size_t count = 0;
+	};
+
+	LoopbackTransport(std::shared_ptr<Channel> in, std::shared_ptr<Channel> out);
+
+	std::shared_ptr<Channel> in;
+	std::shared_ptr<Channel> out;
+};
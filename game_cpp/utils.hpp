@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
+#include <type_traits>
 
 //-------------------------------------------------------
 //	Math utils
@@ -13,7 +15,7 @@ constexpr float EPSILON = 0.01f;
 
 inline float scopedAngle(float angle)
 {
-	angle = std::fmodf(angle, 2*math::PI);
+	angle = std::fmod(angle, 2*math::PI);
 	if (angle < 0)
 		angle += 2 * math::PI;
 	return angle;
@@ -35,11 +37,17 @@ inline bool isAbsEqual(float value1, float value2)
 	return isZero(fabs(value1) - fabs(value2));
 }
 
+constexpr float clamp(float value, float low, float high)
+{
+	return value < low ? low : (value > high ? high : value);
+}
+
 } // namespace math
 
 
 //-------------------------------------------------------
 //	Basic Vector2 class
+//	trivially copyable, so arrays of it can be moved with memcpy
 //-------------------------------------------------------
 
 class Vector2
@@ -48,35 +56,390 @@ public:
 	float x;
 	float y;
 
-	Vector2() :
+	constexpr Vector2() :
 		x(0.f),
 		y(0.f)
 	{ }
-	Vector2(float vx, float vy) :
+	constexpr Vector2(float vx, float vy) :
 		x(vx),
 		y(vy)
 	{ }
 
-	Vector2(Vector2 const &other) :
-		x(other.x),
-		y(other.y)
-	{ }
+	// unit vector at the angle from the x axis
+	static Vector2 fromAngle(float angle) { return Vector2(cosf(angle), sinf(angle)); }
 
 	inline bool isZero() const { return math::isZero(x) && math::isZero(y); }
 	inline float length() const { return sqrtf(x*x + y* y); }
+	constexpr float lengthSquared() const { return x*x + y*y; }
+	// zero vector stays zero
+	inline Vector2 normalized() const;
+	// counterclockwise
+	inline Vector2 rotated(float angle) const;
+	constexpr Vector2 perpendicular() const { return Vector2(-y, x); }
+
+	constexpr Vector2& operator += (Vector2 const &other) { x += other.x; y += other.y; return *this; }
+	constexpr Vector2& operator -= (Vector2 const &other) { x -= other.x; y -= other.y; return *this; }
+	constexpr Vector2& operator *= (float scale) { x *= scale; y *= scale; return *this; }
 };
 
-inline Vector2 operator + (Vector2 const &left, Vector2 const &right)
+static_assert(std::is_trivially_copyable<Vector2>::value, "Vector2 is expected to be copied as plain memory");
+
+constexpr Vector2 operator + (Vector2 const &left, Vector2 const &right)
 {
 	return Vector2(left.x + right.x, left.y + right.y);
 }
 
-inline Vector2 operator - (Vector2 const &left, Vector2 const &right)
+constexpr Vector2 operator - (Vector2 const &left, Vector2 const &right)
 {
 	return Vector2(left.x - right.x, left.y - right.y);
 }
 
-inline Vector2 operator * (float left, Vector2 const &right)
+constexpr Vector2 operator - (Vector2 const &value)
+{
+	return Vector2(-value.x, -value.y);
+}
+
+constexpr Vector2 operator * (float left, Vector2 const &right)
 {
 	return Vector2(left * right.x, left * right.y);
-}
\ No newline at end of file
+}
+
+constexpr Vector2 operator * (Vector2 const &left, float right)
+{
+	return Vector2(left.x * right, left.y * right);
+}
+
+constexpr Vector2 operator / (Vector2 const &left, float right)
+{
+	return Vector2(left.x / right, left.y / right);
+}
+
+constexpr bool operator == (Vector2 const &left, Vector2 const &right)
+{
+	return left.x == right.x && left.y == right.y;
+}
+
+constexpr bool operator != (Vector2 const &left, Vector2 const &right)
+{
+	return !(left == right);
+}
+
+constexpr float dot(Vector2 const &left, Vector2 const &right)
+{
+	return left.x * right.x + left.y * right.y;
+}
+
+// z of the 3d cross product, positive if right is counterclockwise from left
+constexpr float cross(Vector2 const &left, Vector2 const &right)
+{
+	return left.x * right.y - left.y * right.x;
+}
+
+inline Vector2 Vector2::normalized() const
+{
+	const float len = length();
+	return len > 0.f ? *this / len : Vector2();
+}
+
+inline Vector2 Vector2::rotated(float angle) const
+{
+	const float c = cosf(angle);
+	const float s = sinf(angle);
+	return Vector2(c * x - s * y, s * x + c * y);
+}
+
+
+//-------------------------------------------------------
+//	Vector lanes
+//	N floats or vectors processed together, one array per component.
+//	Every operation is a plain loop over the lanes, which the compiler
+//	turns into vector instructions, so no intrinsics are needed.
+//-------------------------------------------------------
+
+template<size_t N>
+struct FloatxN
+{
+	float lanes[N];
+
+	static FloatxN broadcast(float value)
+	{
+		FloatxN result;
+		for (size_t i = 0; i < N; ++i)
+			result.lanes[i] = value;
+		return result;
+	}
+
+	float operator [] (size_t lane) const { return lanes[lane]; }
+	float& operator [] (size_t lane) { return lanes[lane]; }
+};
+
+template<size_t N>
+inline FloatxN<N> operator + (FloatxN<N> const &left, FloatxN<N> const &right)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = left.lanes[i] + right.lanes[i];
+	return result;
+}
+
+template<size_t N>
+inline FloatxN<N> operator - (FloatxN<N> const &left, FloatxN<N> const &right)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = left.lanes[i] - right.lanes[i];
+	return result;
+}
+
+template<size_t N>
+inline FloatxN<N> operator * (FloatxN<N> const &left, FloatxN<N> const &right)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = left.lanes[i] * right.lanes[i];
+	return result;
+}
+
+template<size_t N>
+inline FloatxN<N> sqrt(FloatxN<N> const &value)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = sqrtf(value.lanes[i]);
+	return result;
+}
+
+
+template<size_t N>
+struct Vector2xN
+{
+	static constexpr size_t LANES = N;
+
+	float x[N];
+	float y[N];
+
+	static Vector2xN broadcast(Vector2 value)
+	{
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			result.x[i] = value.x;
+			result.y[i] = value.y;
+		}
+		return result;
+	}
+
+	// N consecutive components from each array
+	static Vector2xN load(const float *xs, const float *ys)
+	{
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			result.x[i] = xs[i];
+			result.y[i] = ys[i];
+		}
+		return result;
+	}
+
+	void store(float *xs, float *ys) const
+	{
+		for (size_t i = 0; i < N; ++i)
+		{
+			xs[i] = x[i];
+			ys[i] = y[i];
+		}
+	}
+
+	// unit vectors at the angles of the lanes from the x axis
+	static Vector2xN fromAngle(FloatxN<N> const &angles)
+	{
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			result.x[i] = cosf(angles.lanes[i]);
+			result.y[i] = sinf(angles.lanes[i]);
+		}
+		return result;
+	}
+
+	Vector2 get(size_t lane) const { return Vector2(x[lane], y[lane]); }
+	void set(size_t lane, Vector2 value) { x[lane] = value.x; y[lane] = value.y; }
+
+	FloatxN<N> lengthSquared() const
+	{
+		FloatxN<N> result;
+		for (size_t i = 0; i < N; ++i)
+			result.lanes[i] = x[i] * x[i] + y[i] * y[i];
+		return result;
+	}
+
+	FloatxN<N> length() const { return sqrt(lengthSquared()); }
+
+	Vector2xN normalized() const
+	{
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			const float len = sqrtf(x[i] * x[i] + y[i] * y[i]);
+			const float scale = len > 0.f ? 1.f / len : 0.f;
+			result.x[i] = x[i] * scale;
+			result.y[i] = y[i] * scale;
+		}
+		return result;
+	}
+
+	Vector2xN rotated(float angle) const
+	{
+		const float c = cosf(angle);
+		const float s = sinf(angle);
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			result.x[i] = c * x[i] - s * y[i];
+			result.y[i] = s * x[i] + c * y[i];
+		}
+		return result;
+	}
+
+	Vector2xN perpendicular() const
+	{
+		Vector2xN result;
+		for (size_t i = 0; i < N; ++i)
+		{
+			result.x[i] = -y[i];
+			result.y[i] = x[i];
+		}
+		return result;
+	}
+
+	Vector2xN& operator += (Vector2xN const &other) { return *this = *this + other; }
+	Vector2xN& operator -= (Vector2xN const &other) { return *this = *this - other; }
+	Vector2xN& operator *= (float scale) { return *this = scale * *this; }
+
+	// true if the vectors of all lanes are zero
+	bool isZero() const
+	{
+		for (size_t i = 0; i < N; ++i)
+		{
+			if (!math::isZero(x[i]) || !math::isZero(y[i]))
+				return false;
+		}
+		return true;
+	}
+};
+
+typedef FloatxN<4> Floatx4;
+typedef FloatxN<8> Floatx8;
+typedef Vector2xN<4> Vector2x4;
+typedef Vector2xN<8> Vector2x8;
+
+static_assert(std::is_trivially_copyable<Vector2x8>::value, "lanes are expected to be copied as plain memory");
+
+template<size_t N>
+inline Vector2xN<N> operator + (Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	Vector2xN<N> result;
+	for (size_t i = 0; i < N; ++i)
+	{
+		result.x[i] = left.x[i] + right.x[i];
+		result.y[i] = left.y[i] + right.y[i];
+	}
+	return result;
+}
+
+template<size_t N>
+inline Vector2xN<N> operator - (Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	Vector2xN<N> result;
+	for (size_t i = 0; i < N; ++i)
+	{
+		result.x[i] = left.x[i] - right.x[i];
+		result.y[i] = left.y[i] - right.y[i];
+	}
+	return result;
+}
+
+template<size_t N>
+inline Vector2xN<N> operator * (float left, Vector2xN<N> const &right)
+{
+	Vector2xN<N> result;
+	for (size_t i = 0; i < N; ++i)
+	{
+		result.x[i] = left * right.x[i];
+		result.y[i] = left * right.y[i];
+	}
+	return result;
+}
+
+template<size_t N>
+inline Vector2xN<N> operator - (Vector2xN<N> const &value)
+{
+	return -1.f * value;
+}
+
+template<size_t N>
+inline Vector2xN<N> operator * (Vector2xN<N> const &left, float right)
+{
+	return right * left;
+}
+
+template<size_t N>
+inline Vector2xN<N> operator / (Vector2xN<N> const &left, float right)
+{
+	Vector2xN<N> result;
+	for (size_t i = 0; i < N; ++i)
+	{
+		result.x[i] = left.x[i] / right;
+		result.y[i] = left.y[i] / right;
+	}
+	return result;
+}
+
+// true if all lanes are equal, like Vector2 it compares exactly
+template<size_t N>
+inline bool operator == (Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	for (size_t i = 0; i < N; ++i)
+	{
+		if (left.x[i] != right.x[i] || left.y[i] != right.y[i])
+			return false;
+	}
+	return true;
+}
+
+template<size_t N>
+inline bool operator != (Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	return !(left == right);
+}
+
+// every lane scaled by its own factor
+template<size_t N>
+inline Vector2xN<N> operator * (FloatxN<N> const &left, Vector2xN<N> const &right)
+{
+	Vector2xN<N> result;
+	for (size_t i = 0; i < N; ++i)
+	{
+		result.x[i] = left.lanes[i] * right.x[i];
+		result.y[i] = left.lanes[i] * right.y[i];
+	}
+	return result;
+}
+
+template<size_t N>
+inline FloatxN<N> dot(Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = left.x[i] * right.x[i] + left.y[i] * right.y[i];
+	return result;
+}
+
+template<size_t N>
+inline FloatxN<N> cross(Vector2xN<N> const &left, Vector2xN<N> const &right)
+{
+	FloatxN<N> result;
+	for (size_t i = 0; i < N; ++i)
+		result.lanes[i] = left.x[i] * right.y[i] - left.y[i] * right.x[i];
+	return result;
+}
@@ -0,0 +1,191 @@
+#include "wind_field.hpp"
+
+#include <cmath>
+#include <random>
+
+#include "../framework/game.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define WIND_SSE2 1
+#endif
+
+namespace
+{
+	constexpr int TILE_SHIFT = 3;
+	constexpr int TILE_MASK = WindField::TILE_SIZE - 1;
+	constexpr int GRID_MASK = WindField::GRID_SIZE - 1;
+	constexpr float PERIOD = WindField::GRID_SIZE * params::wind::CELL_SIZE;
+
+	static_assert(WindField::TILE_SIZE == 1 << TILE_SHIFT, "tile size is expected to be 8");
+	static_assert(WindField::TILES == WindField::TILE_SIZE, "vector index math assumes square 8x8 tiling");
+	static_assert((WindField::GRID_SIZE & GRID_MASK) == 0, "grid size is expected to be a power of two");
+
+	// tile after tile, row by row inside a tile; x and y are already wrapped
+	inline int tiledIndex(int x, int y)
+	{
+		return ((((y >> TILE_SHIFT) * WindField::TILES) + (x >> TILE_SHIFT)) << (2 * TILE_SHIFT)) |
+			((y & TILE_MASK) << TILE_SHIFT) | (x & TILE_MASK);
+	}
+
+#ifdef WIND_SSE2
+	inline __m128i tiledIndex(__m128i x, __m128i y)
+	{
+		const __m128i tileMask = _mm_set1_epi32(TILE_MASK);
+		const __m128i tile = _mm_or_si128(_mm_slli_epi32(_mm_srli_epi32(y, TILE_SHIFT), TILE_SHIFT), _mm_srli_epi32(x, TILE_SHIFT));
+		const __m128i inTile = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(y, tileMask), TILE_SHIFT), _mm_and_si128(x, tileMask));
+		return _mm_or_si128(_mm_slli_epi32(tile, 2 * TILE_SHIFT), inTile);
+	}
+
+	inline __m128i floorToInt(__m128 value)
+	{
+		// truncation rounds negatives up, step them one down
+		const __m128i truncated = _mm_cvttps_epi32(value);
+		const __m128 isAbove = _mm_cmplt_ps(value, _mm_cvtepi32_ps(truncated));
+		return _mm_add_epi32(truncated, _mm_castps_si128(isAbove));
+	}
+
+	inline __m128 gather(const float *values, const int *indices)
+	{
+		return _mm_setr_ps(values[indices[0]], values[indices[1]], values[indices[2]], values[indices[3]]);
+	}
+
+	inline __m128 lerp(__m128 from, __m128 to, __m128 t)
+	{
+		return _mm_add_ps(from, _mm_mul_ps(t, _mm_sub_ps(to, from)));
+	}
+#endif
+}
+
+
+void WindField::init(unsigned seed)
+{
+	std::mt19937 random(seed);
+	const float direction = std::uniform_real_distribution<float>(0.f, 2.f * math::PI)(random);
+	fill(base, seed, params::wind::BASE_SPEED, direction, 0.4f);
+	fill(gusts, seed + 1, params::wind::GUST_SPEED, direction, math::PI);
+	gustDrift = params::wind::GUST_DRIFT_SPEED * Vector2(std::cos(direction), std::sin(direction));
+}
+
+
+void WindField::fill(Grid &grid, unsigned seed, float speed, float direction, float spread)
+{
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> noise(-1.f, 1.f);
+	grid.u.resize(GRID_SIZE * GRID_SIZE);
+	grid.v.resize(GRID_SIZE * GRID_SIZE);
+	for (int y = 0; y < GRID_SIZE; ++y)
+	{
+		for (int x = 0; x < GRID_SIZE; ++x)
+		{
+			const float angle = direction + spread * noise(random);
+			const float strength = speed * (1.f + 0.3f * noise(random));
+			grid.u[tiledIndex(x, y)] = strength * std::cos(angle);
+			grid.v[tiledIndex(x, y)] = strength * std::sin(angle);
+		}
+	}
+}
+
+
+void WindField::sample(const float *x, const float *y, float *u, float *v, size_t count, double time) const
+{
+	sampleGrid(base, x, y, 0.f, 0.f, u, v, count, false);
+
+	// gusts drift downwind, the offset is kept within one period to keep precision
+	const float offsetX = static_cast<float>(std::fmod(-gustDrift.x * time, static_cast<double>(PERIOD)));
+	const float offsetY = static_cast<float>(std::fmod(-gustDrift.y * time, static_cast<double>(PERIOD)));
+	sampleGrid(gusts, x, y, offsetX, offsetY, u, v, count, true);
+}
+
+
+Vector2 WindField::sample(Vector2 position, double time) const
+{
+	Vector2 wind;
+	sample(&position.x, &position.y, &wind.x, &wind.y, 1, time);
+	return wind;
+}
+
+
+void WindField::sampleGrid(const Grid &grid, const float *x, const float *y, float offsetX, float offsetY,
+						   float *u, float *v, size_t count, bool accumulate)
+{
+	const float invCell = 1.f / params::wind::CELL_SIZE;
+	size_t i = 0;
+
+#ifdef WIND_SSE2
+	const __m128 invCell4 = _mm_set1_ps(invCell);
+	const __m128 offsetX4 = _mm_set1_ps(offsetX);
+	const __m128 offsetY4 = _mm_set1_ps(offsetY);
+	const __m128i gridMask = _mm_set1_epi32(GRID_MASK);
+	const __m128i one = _mm_set1_epi32(1);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		const __m128 cellX = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(x + i), offsetX4), invCell4);
+		const __m128 cellY = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(y + i), offsetY4), invCell4);
+		const __m128i floorX = floorToInt(cellX);
+		const __m128i floorY = floorToInt(cellY);
+		const __m128 tx = _mm_sub_ps(cellX, _mm_cvtepi32_ps(floorX));
+		const __m128 ty = _mm_sub_ps(cellY, _mm_cvtepi32_ps(floorY));
+
+		const __m128i x0 = _mm_and_si128(floorX, gridMask);
+		const __m128i y0 = _mm_and_si128(floorY, gridMask);
+		const __m128i x1 = _mm_and_si128(_mm_add_epi32(floorX, one), gridMask);
+		const __m128i y1 = _mm_and_si128(_mm_add_epi32(floorY, one), gridMask);
+
+		alignas(16) int corners[4][4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(corners[0]), tiledIndex(x0, y0));
+		_mm_store_si128(reinterpret_cast<__m128i*>(corners[1]), tiledIndex(x1, y0));
+		_mm_store_si128(reinterpret_cast<__m128i*>(corners[2]), tiledIndex(x0, y1));
+		_mm_store_si128(reinterpret_cast<__m128i*>(corners[3]), tiledIndex(x1, y1));
+
+		const __m128 bottomU = lerp(gather(grid.u.data(), corners[0]), gather(grid.u.data(), corners[1]), tx);
+		const __m128 topU = lerp(gather(grid.u.data(), corners[2]), gather(grid.u.data(), corners[3]), tx);
+		const __m128 bottomV = lerp(gather(grid.v.data(), corners[0]), gather(grid.v.data(), corners[1]), tx);
+		const __m128 topV = lerp(gather(grid.v.data(), corners[2]), gather(grid.v.data(), corners[3]), tx);
+		__m128 resultU = lerp(bottomU, topU, ty);
+		__m128 resultV = lerp(bottomV, topV, ty);
+		if (accumulate)
+		{
+			resultU = _mm_add_ps(resultU, _mm_loadu_ps(u + i));
+			resultV = _mm_add_ps(resultV, _mm_loadu_ps(v + i));
+		}
+		_mm_storeu_ps(u + i, resultU);
+		_mm_storeu_ps(v + i, resultV);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		float sampleU;
+		float sampleV;
+		sampleGridScalar(grid, (x[i] + offsetX) * invCell, (y[i] + offsetY) * invCell, sampleU, sampleV);
+		u[i] = sampleU + (accumulate ? u[i] : 0.f);
+		v[i] = sampleV + (accumulate ? v[i] : 0.f);
+	}
+}
+
+
+void WindField::sampleGridScalar(const Grid &grid, float cellX, float cellY, float &u, float &v)
+{
+	const float floorX = std::floor(cellX);
+	const float floorY = std::floor(cellY);
+	const float tx = cellX - floorX;
+	const float ty = cellY - floorY;
+	const int x0 = static_cast<int>(floorX) & GRID_MASK;
+	const int y0 = static_cast<int>(floorY) & GRID_MASK;
+	const int x1 = (x0 + 1) & GRID_MASK;
+	const int y1 = (y0 + 1) & GRID_MASK;
+
+	const int i00 = tiledIndex(x0, y0);
+	const int i10 = tiledIndex(x1, y0);
+	const int i01 = tiledIndex(x0, y1);
+	const int i11 = tiledIndex(x1, y1);
+
+	const float bottomU = grid.u[i00] + tx * (grid.u[i10] - grid.u[i00]);
+	const float topU = grid.u[i01] + tx * (grid.u[i11] - grid.u[i01]);
+	const float bottomV = grid.v[i00] + tx * (grid.v[i10] - grid.v[i00]);
+	const float topV = grid.v[i01] + tx * (grid.v[i11] - grid.v[i01]);
+	u = bottomU + ty * (topU - bottomU);
+	v = bottomV + ty * (topV - bottomV);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <cstddef>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Wind over the sea
+//	two periodic grids: a static one and a gust one which drifts with time.
+//	Nodes are stored in 8x8 tiles, so neighbouring samples share cache lines.
+//-------------------------------------------------------
+
+class WindField
+{
+public:
+	static constexpr int TILE_SIZE = 8;
+	static constexpr int TILES = 8;
+	// grid wraps around after this many cells
+	static constexpr int GRID_SIZE = TILE_SIZE * TILES;
+
+	void init(unsigned seed);
+
+	// writes the wind at (x[i], y[i]) to (u[i], v[i]), four samples at a time where SSE2 is available
+	void sample(const float *x, const float *y, float *u, float *v, size_t count, double time) const;
+	Vector2 sample(Vector2 position, double time) const;
+
+private:
+	struct Grid
+	{
+		std::vector<float> u;
+		std::vector<float> v;
+	};
+
+	static void fill(Grid &grid, unsigned seed, float speed, float direction, float spread);
+	static void sampleGrid(const Grid &grid, const float *x, const float *y, float offsetX, float offsetY,
+						   float *u, float *v, size_t count, bool accumulate);
+	static void sampleGridScalar(const Grid &grid, float cellX, float cellY, float &u, float &v);
+
+	Grid base;
+	Grid gusts;
+	Vector2 gustDrift;
+};
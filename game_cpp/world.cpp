@@ -0,0 +1,242 @@
+#include "world.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <type_traits>
+
+namespace
+{
+	// each carrier reserves a range of stream ids for itself and its side numbers
+	constexpr uint16_t IDS_PER_SHIP = params::ship::AICRAFTS_COUNT + 1;
+	// hits on a target are reported in steps of this many
+	constexpr uint32_t HITS_LOG_STEP = 100;
+	// HUD: carrier line, a line per aircraft state, a gap, then refuel timers
+	constexpr int HUD_STATES_LINE = 1;
+	constexpr int HUD_FUELING_LINE = HUD_STATES_LINE + static_cast<int>(AICRAFT_STATES_COUNT) + 1;
+}
+
+
+void World::init(const WingLayout &wing)
+{
+	assert(ships.empty());
+	wind.init(params::wind::SEED);
+	navigation.init(params::navigation::SEED);
+	projectiles.init(navigation, params::world::SHIPS_COUNT);
+	loggedHits.assign(params::world::SHIPS_COUNT, 0);
+	ships.reserve(params::world::SHIPS_COUNT);
+	for (int i = 0; i < params::world::SHIPS_COUNT; ++i)
+	{
+		ships.push_back(std::make_unique<Ship>());
+		ships.back()->init(Vector2(0.f, -params::world::SHIP_SPACING * i), 0.f, &projectiles, wing);
+	}
+	selected = 0;
+	scene::placeCamera(ships[selected]->getPosition().x, ships[selected]->getPosition().y);
+}
+
+
+void World::deinit()
+{
+	for (auto &ship : ships)
+		ship->deinit();
+	ships.clear();
+	projectiles.clear();
+	navigation.deinit();
+}
+
+
+template<class FlightModel>
+void World::updateSquadrons(float dt)
+{
+	for (auto &ship : ships)
+		ship->getAicrafts().squadron<FlightModel>().update(ship->getTime(), dt, wind, detail);
+}
+
+
+void World::update(float dt)
+{
+	// aircrafts test against the hull motion of this step and steer by the flow field towards it, so hulls go first
+	for (auto &ship : ships)
+	{
+		ship->updateMotion(dt);
+		ship->updateFlowField(navigation);
+	}
+
+	// aircrafts in the view are steered every frame, the rest less often
+	Vector2 viewMin(0.f, 0.f);
+	Vector2 viewMax(1.f, 1.f);
+	scene::screenToWorld(&viewMin.x, &viewMin.y);
+	scene::screenToWorld(&viewMax.x, &viewMax.y);
+	detail.beginFrame(viewMin, viewMax, dt);
+
+	updateSquadrons<flight_model::Fighter>(dt);
+	updateSquadrons<flight_model::Tanker>(dt);
+	updateSquadrons<flight_model::Awacs>(dt);
+	updateProjectiles(dt);
+
+	const Vector2 &cameraTarget = ships[selected]->getPosition();
+	scene::placeCamera(cameraTarget.x, cameraTarget.y);
+	updateHud();
+}
+
+
+// every line is set each frame, the scene lays the text out again only when it changed;
+// seconds are whole, so the text changes about once a second
+void World::updateHud()
+{
+	char text[scene::HUD_LINE_LENGTH + 1];
+	Ship &ship = *ships[selected];
+	snprintf(text, sizeof(text), "CARRIER %d/%d  TIME %d S", static_cast<int>(selected + 1), static_cast<int>(ships.size()),
+		static_cast<int>(ship.getTime()));
+	scene::setHudLine(0, text);
+
+	int counts[AICRAFT_STATES_COUNT] = {};
+	int line = HUD_FUELING_LINE;
+	const double now = ship.getTime();
+	ship.getAicrafts().forEach([&counts, &line, &text, now](const auto &aicraft)
+	{
+		const AicraftState state = aicraft.getState();
+		++counts[static_cast<size_t>(state)];
+		if (state != AicraftState::Fueling || line >= scene::HUD_LINES)
+			return;
+		const float total = static_cast<float>(std::decay_t<decltype(aicraft)>::Model::FUELING_TIME_SEC);
+		const double left = std::max(aicraft.getNextStateTime() - now, 0.0);
+		snprintf(text, sizeof(text), "#%-2d FUELING %3d S", aicraft.getNumber(), static_cast<int>(std::ceil(left)));
+		scene::setHudLine(line++, text, 1.f - static_cast<float>(left) / total);
+	});
+
+	for (size_t i = 0; i < AICRAFT_STATES_COUNT; ++i)
+	{
+		snprintf(text, sizeof(text), "%-14s %2d", toString(static_cast<AicraftState>(i)), counts[i]);
+		scene::setHudLine(HUD_STATES_LINE + static_cast<int>(i), text,
+			static_cast<float>(counts[i]) / params::ship::AICRAFTS_COUNT);
+	}
+	scene::setHudLine(HUD_FUELING_LINE - 1, "");
+	for (; line < scene::HUD_LINES; ++line)
+		scene::setHudLine(line, "");
+}
+
+
+// rounds fired this step move within it too, against targets where they are now
+void World::updateProjectiles(float dt)
+{
+	projectiles.clearTargets();
+	for (size_t i = 0; i < ships.size(); ++i)
+	{
+		if (ships[i]->hasTarget())
+			projectiles.addTarget(ships[i]->getTarget(), params::projectile::TARGET_RADIUS, static_cast<int>(i));
+	}
+	projectiles.update(dt);
+
+	for (size_t i = 0; i < ships.size(); ++i)
+	{
+		const uint32_t hits = projectiles.getHits(static_cast<int>(i));
+		if (hits >= loggedHits[i] + HITS_LOG_STEP)
+		{
+			loggedHits[i] = hits - hits % HITS_LOG_STEP;
+			GAME_LOG(game::LOG_INFO, "Target of ship %d hit %u times", static_cast<int>(i), hits);
+		}
+	}
+}
+
+
+void World::keyPressed(int key)
+{
+	if (key == game::KEY_NEXT_SHIP)
+	{
+		select((selected + 1) % ships.size());
+		return;
+	}
+	if (key == game::KEY_RECALL)
+	{
+		recallAicraftsInView();
+		return;
+	}
+	ships[selected]->keyPressed(key);
+}
+
+
+void World::keyReleased(int key)
+{
+	if (key == game::KEY_NEXT_SHIP || key == game::KEY_RECALL)
+		return;
+	ships[selected]->keyReleased(key);
+}
+
+
+void World::mouseClicked(Vector2 worldPosition, bool isLeftButton)
+{
+	if (!isLeftButton)
+	{
+		ships[selected]->tryLaunchAicraft();
+		return;
+	}
+
+	const int clicked = findShip(worldPosition);
+	if (clicked >= 0)
+	{
+		select(static_cast<size_t>(clicked));
+		return;
+	}
+
+	scene::placeGoalMarker(worldPosition.x, worldPosition.y);
+	ships[selected]->setTarget(worldPosition);
+}
+
+
+void World::select(size_t index)
+{
+	if (index == selected)
+		return;
+
+	// keys held for the previous carrier must not keep it moving
+	ships[selected]->releaseKeys();
+	selected = index;
+	GAME_LOG(game::LOG_INFO, "Ship %d selected", static_cast<int>(selected));
+
+	const Ship &ship = *ships[selected];
+	if (ship.hasTarget())
+		scene::placeGoalMarker(ship.getTarget().x, ship.getTarget().y);
+}
+
+
+int World::findShip(Vector2 worldPosition) const
+{
+	const scene::Mesh *mesh = scene::pick(worldPosition.x, worldPosition.y, scene::MESH_SHIP);
+	if (!mesh)
+		return -1;
+	const Ship *ship = static_cast<const Ship*>(scene::getMeshOwner(mesh));
+	for (size_t i = 0; i < ships.size(); ++i)
+	{
+		if (ships[i].get() == ship)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+
+// every aircraft on screen heads home, whichever carrier it belongs to
+void World::recallAicraftsInView()
+{
+	Vector2 bottomLeft(0.f, 0.f);
+	Vector2 topRight(1.f, 1.f);
+	scene::screenToWorld(&bottomLeft.x, &bottomLeft.y);
+	scene::screenToWorld(&topRight.x, &topRight.y);
+
+	queryResult.clear();
+	scene::queryRect(bottomLeft.x, bottomLeft.y, topRight.x, topRight.y, queryResult, scene::MESH_AIRCRAFT);
+	for (const scene::Mesh *mesh : queryResult)
+	{
+		AicraftBase *aicraft = static_cast<AicraftBase*>(scene::getMeshOwner(mesh));
+		aicraft->getShip()->recallAicraft(aicraft);
+	}
+	GAME_LOG(game::LOG_INFO, "Recall sent to %d aircrafts in view", static_cast<int>(queryResult.size()));
+}
+
+
+void World::collectPoses(WorldSnapshot &snapshot) const
+{
+	for (size_t i = 0; i < ships.size(); ++i)
+		ships[i]->collectPoses(snapshot, static_cast<uint16_t>(i * IDS_PER_SHIP));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "detail_scheduler.hpp"
+#include "navigation.hpp"
+#include "projectiles.hpp"
+#include "ship.hpp"
+#include "wind_field.hpp"
+
+#include <memory>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	World of several carriers
+//	player controls the selected one, updates go in batched passes:
+//	all hulls first, then every flight model across all carriers
+//-------------------------------------------------------
+
+class World
+{
+public:
+	// every carrier takes the same wing
+	void init(const WingLayout &wing = WingLayout());
+	void deinit();
+	void update(float dt);
+	void keyPressed(int key);
+	void keyReleased(int key);
+	void mouseClicked(Vector2 worldPosition, bool isLeftButton);
+
+	Ship& getSelected() { return *ships[selected]; }
+	size_t getShipsCount() const { return ships.size(); }
+
+	void collectPoses(WorldSnapshot &snapshot) const;
+
+private:
+	template<class FlightModel>
+	void updateSquadrons(float dt);
+	void select(size_t index);
+	int findShip(Vector2 worldPosition) const;
+	void recallAicraftsInView();
+	void updateProjectiles(float dt);
+	void updateHud();
+
+	// ships are never moved, aircrafts keep pointers to them
+	std::vector<std::unique_ptr<Ship>> ships;
+	size_t selected = 0;
+	WindField wind;
+	DetailScheduler detail;
+	NavigationMap navigation;
+	// rounds of all carriers, target markers are their bodies
+	Projectiles projectiles;
+	std::vector<uint32_t> loggedHits;
+	// reused by area queries, so they do not allocate
+	std::vector<scene::Mesh*> queryResult;
+};
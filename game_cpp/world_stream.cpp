@@ -0,0 +1,385 @@
+#include "world_stream.hpp"
+
+#include <cmath>
+
+#include "../framework/alloc_tracker.hpp"
+
+namespace
+{
+	constexpr uint8_t SNAPSHOT_MAGIC = 0xB5;
+	constexpr uint8_t ACK_MAGIC = 0xAC;
+
+	constexpr float POSITION_SCALE = 512.f;
+	constexpr float ANGLE_SCALE = 65536.f / (2.f * math::PI);
+
+	enum : uint8_t
+	{
+		CHANGED_X = 1 << 0,
+		CHANGED_Y = 1 << 1,
+		CHANGED_ANGLE = 1 << 2,
+		CHANGED_STATE = 1 << 3
+	};
+
+	const world_stream::QuantizedPose ZERO_POSE = {};
+
+
+	void writeVarint(Packet &out, uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	void writeSigned(Packet &out, int32_t value)
+	{
+		writeVarint(out, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+	}
+
+	class Reader
+	{
+	public:
+		explicit Reader(const Packet &packet) : data(packet.data()), end(packet.data() + packet.size()) {}
+
+		bool byte(uint8_t &value)
+		{
+			if (data == end)
+				return false;
+			value = *data++;
+			return true;
+		}
+
+		bool varint(uint32_t &value)
+		{
+			value = 0;
+			for (int shift = 0; shift < 35; shift += 7)
+			{
+				uint8_t next;
+				if (!byte(next))
+					return false;
+				value |= static_cast<uint32_t>(next & 0x7F) << shift;
+				if (!(next & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		bool signedVarint(int32_t &value)
+		{
+			uint32_t raw;
+			if (!varint(raw))
+				return false;
+			value = static_cast<int32_t>((raw >> 1) ^ (~(raw & 1) + 1));
+			return true;
+		}
+
+		bool atEnd() const { return data == end; }
+		size_t remaining() const { return static_cast<size_t>(end - data); }
+
+	private:
+		const uint8_t *data;
+		const uint8_t *end;
+	};
+
+	// walks base entities in id order alongside the current ones
+	const world_stream::QuantizedPose& findBase(const world_stream::QuantizedSnapshot *base, size_t &cursor, uint16_t id)
+	{
+		if (!base)
+			return ZERO_POSE;
+		while (cursor < base->entities.size() && base->entities[cursor].id < id)
+			++cursor;
+		if (cursor < base->entities.size() && base->entities[cursor].id == id)
+			return base->entities[cursor];
+		return ZERO_POSE;
+	}
+
+	const world_stream::QuantizedSnapshot* findInHistory(const world_stream::History &history, uint32_t sequence)
+	{
+		if (sequence == 0)
+			return nullptr;
+		const world_stream::QuantizedSnapshot &snapshot = history[sequence % world_stream::HISTORY_SIZE];
+		return snapshot.sequence == sequence ? &snapshot : nullptr;
+	}
+}
+
+
+//-------------------------------------------------------
+//	Codec
+//-------------------------------------------------------
+
+namespace world_stream
+{
+	void quantize(const WorldSnapshot &snapshot, QuantizedSnapshot &out)
+	{
+		out.entities.resize(snapshot.entities.size());
+		for (size_t i = 0; i < snapshot.entities.size(); ++i)
+		{
+			const EntityPose &pose = snapshot.entities[i];
+			QuantizedPose &quantized = out.entities[i];
+			quantized.id = pose.id;
+			quantized.kind = static_cast<uint8_t>(pose.kind);
+			quantized.state = static_cast<uint8_t>(pose.state);
+			quantized.x = static_cast<int32_t>(std::lround(pose.x * POSITION_SCALE));
+			quantized.y = static_cast<int32_t>(std::lround(pose.y * POSITION_SCALE));
+			quantized.angle = static_cast<uint16_t>(std::lround(math::scopedAngle(pose.angle) * ANGLE_SCALE) & 0xFFFF);
+		}
+	}
+
+	void dequantize(const QuantizedSnapshot &snapshot, WorldSnapshot &out)
+	{
+		out.entities.resize(snapshot.entities.size());
+		for (size_t i = 0; i < snapshot.entities.size(); ++i)
+		{
+			const QuantizedPose &quantized = snapshot.entities[i];
+			EntityPose &pose = out.entities[i];
+			pose.id = quantized.id;
+			pose.kind = static_cast<EntityKind>(quantized.kind);
+			pose.state = static_cast<AicraftState>(quantized.state);
+			pose.x = quantized.x / POSITION_SCALE;
+			pose.y = quantized.y / POSITION_SCALE;
+			pose.angle = quantized.angle / ANGLE_SCALE;
+		}
+	}
+
+	void encode(const QuantizedSnapshot &snapshot, const QuantizedSnapshot *base, Packet &out)
+	{
+		out.clear();
+		out.push_back(SNAPSHOT_MAGIC);
+		writeVarint(out, snapshot.sequence);
+		writeVarint(out, base ? base->sequence : 0);
+		writeVarint(out, static_cast<uint32_t>(snapshot.entities.size()));
+
+		size_t cursor = 0;
+		uint16_t previousId = 0;
+		for (const QuantizedPose &pose : snapshot.entities)
+		{
+			const QuantizedPose &from = findBase(base, cursor, pose.id);
+			const int16_t angleDelta = static_cast<int16_t>(pose.angle - from.angle);
+
+			uint8_t flags = 0;
+			if (pose.x != from.x)
+				flags |= CHANGED_X;
+			if (pose.y != from.y)
+				flags |= CHANGED_Y;
+			if (angleDelta != 0)
+				flags |= CHANGED_ANGLE;
+			if (pose.state != from.state || pose.kind != from.kind)
+				flags |= CHANGED_STATE;
+
+			writeVarint(out, static_cast<uint16_t>(pose.id - previousId));
+			out.push_back(flags);
+			if (flags & CHANGED_X)
+				writeSigned(out, pose.x - from.x);
+			if (flags & CHANGED_Y)
+				writeSigned(out, pose.y - from.y);
+			if (flags & CHANGED_ANGLE)
+				writeSigned(out, angleDelta);
+			if (flags & CHANGED_STATE)
+				out.push_back(static_cast<uint8_t>(pose.kind << 4 | pose.state));
+			previousId = pose.id;
+		}
+	}
+
+	bool decodeHeader(const Packet &packet, uint32_t &sequence, uint32_t &baseSequence)
+	{
+		Reader reader(packet);
+		uint8_t magic;
+		return reader.byte(magic) && magic == SNAPSHOT_MAGIC && reader.varint(sequence) && reader.varint(baseSequence);
+	}
+
+	bool decode(const Packet &packet, const QuantizedSnapshot *base, QuantizedSnapshot &out)
+	{
+		Reader reader(packet);
+		uint8_t magic;
+		uint32_t baseSequence;
+		uint32_t count;
+		if (!reader.byte(magic) || magic != SNAPSHOT_MAGIC ||
+			!reader.varint(out.sequence) || !reader.varint(baseSequence) || !reader.varint(count))
+			return false;
+		if ((baseSequence != 0) != (base != nullptr) || (base && base->sequence != baseSequence))
+			return false;
+		// every entity takes at least an id delta and flags, a larger count can only come from a broken datagram
+		if (count > reader.remaining() / 2)
+			return false;
+
+		out.entities.resize(count);
+		size_t cursor = 0;
+		uint16_t previousId = 0;
+		for (QuantizedPose &pose : out.entities)
+		{
+			uint32_t idDelta;
+			uint8_t flags;
+			if (!reader.varint(idDelta) || !reader.byte(flags))
+				return false;
+			const uint16_t id = static_cast<uint16_t>(previousId + idDelta);
+			pose = findBase(base, cursor, id);
+			pose.id = id;
+			previousId = id;
+
+			int32_t delta;
+			if (flags & CHANGED_X)
+			{
+				if (!reader.signedVarint(delta))
+					return false;
+				pose.x += delta;
+			}
+			if (flags & CHANGED_Y)
+			{
+				if (!reader.signedVarint(delta))
+					return false;
+				pose.y += delta;
+			}
+			if (flags & CHANGED_ANGLE)
+			{
+				if (!reader.signedVarint(delta))
+					return false;
+				pose.angle = static_cast<uint16_t>(pose.angle + delta);
+			}
+			if (flags & CHANGED_STATE)
+			{
+				uint8_t kindAndState;
+				if (!reader.byte(kindAndState))
+					return false;
+				pose.kind = kindAndState >> 4;
+				pose.state = kindAndState & 0x0F;
+			}
+		}
+		return reader.atEnd();
+	}
+
+	void encodeAck(uint32_t sequence, Packet &out)
+	{
+		out.clear();
+		out.push_back(ACK_MAGIC);
+		writeVarint(out, sequence);
+	}
+
+	bool decodeAck(const Packet &packet, uint32_t &sequence)
+	{
+		Reader reader(packet);
+		uint8_t magic;
+		return reader.byte(magic) && magic == ACK_MAGIC && reader.varint(sequence);
+	}
+}
+
+
+//-------------------------------------------------------
+//	WorldStreamPublisher
+//-------------------------------------------------------
+
+WorldStreamPublisher::WorldStreamPublisher(std::unique_ptr<StreamTransport> transportArg) :
+	transport(std::move(transportArg)),
+	bytesSent(0),
+	packetsSent(0)
+{
+	worker = std::thread(&WorldStreamPublisher::run, this);
+}
+
+WorldStreamPublisher::~WorldStreamPublisher()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeUp.notify_one();
+	worker.join();
+}
+
+void WorldStreamPublisher::publish()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::swap(simSnapshot, pendingSnapshot);
+		hasPending = true;
+	}
+	wakeUp.notify_one();
+	simSnapshot.entities.clear();
+}
+
+void WorldStreamPublisher::receiveAcks()
+{
+	uint32_t acked;
+	while (transport->receive(ack))
+	{
+		if (world_stream::decodeAck(ack, acked) && acked > ackedSequence && acked <= sequence)
+			ackedSequence = acked;
+	}
+}
+
+void WorldStreamPublisher::run()
+{
+	alloc_tracker::Scope scope(alloc_tracker::SUBSYSTEM_STREAM);
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeUp.wait(lock, [this] { return hasPending || stopping; });
+			if (stopping)
+				return;
+			std::swap(pendingSnapshot, workerSnapshot);
+			hasPending = false;
+		}
+
+		receiveAcks();
+
+		++sequence;
+		world_stream::QuantizedSnapshot &current = history[sequence % world_stream::HISTORY_SIZE];
+		current.sequence = sequence;
+		world_stream::quantize(workerSnapshot, current);
+
+		// the slot of a too old ack is already reused, fall back to a key frame
+		const world_stream::QuantizedSnapshot *base = nullptr;
+		if (sequence - ackedSequence < world_stream::HISTORY_SIZE)
+			base = findInHistory(history, ackedSequence);
+
+		world_stream::encode(current, base, packet);
+		transport->send(packet);
+		bytesSent += packet.size();
+		++packetsSent;
+	}
+}
+
+
+//-------------------------------------------------------
+//	WorldStreamClient
+//-------------------------------------------------------
+
+WorldStreamClient::WorldStreamClient(std::unique_ptr<StreamTransport> transportArg) :
+	transport(std::move(transportArg))
+{
+}
+
+bool WorldStreamClient::poll()
+{
+	bool updated = false;
+	while (transport->receive(packet))
+	{
+		uint32_t sequence;
+		uint32_t baseSequence;
+		if (!world_stream::decodeHeader(packet, sequence, baseSequence) || sequence == 0)
+			continue;
+
+		const world_stream::QuantizedSnapshot *base = findInHistory(history, baseSequence);
+		if (baseSequence != 0 && !base)
+			continue;
+
+		// decode aside, base may live in the slot being overwritten
+		world_stream::QuantizedSnapshot decoded;
+		if (!world_stream::decode(packet, base, decoded))
+			continue;
+		history[sequence % world_stream::HISTORY_SIZE] = std::move(decoded);
+
+		world_stream::encodeAck(sequence, ack);
+		transport->send(ack);
+
+		if (sequence > latestSequence)
+		{
+			latestSequence = sequence;
+			world_stream::dequantize(history[sequence % world_stream::HISTORY_SIZE], world);
+			updated = true;
+		}
+	}
+	return updated;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "aircraft.hpp"
+#include "stream_transport.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	World state stream for out-of-process spectators
+//-------------------------------------------------------
+
+enum class EntityKind : uint8_t
+{
+	Ship = 0,
+	Aicraft
+};
+
+struct EntityPose
+{
+	uint16_t id;
+	EntityKind kind;
+	AicraftState state;
+	float x;
+	float y;
+	float angle;
+	float speed;
+	float angularSpeed;
+};
+
+// entities are expected to be sorted by id, ids are unique
+struct WorldSnapshot
+{
+	std::vector<EntityPose> entities;
+};
+
+
+namespace world_stream
+{
+	// positions are quantized to 1/512 of world unit, angles to 1/65536 of turn
+	struct QuantizedPose
+	{
+		uint16_t id;
+		uint8_t kind;
+		uint8_t state;
+		int32_t x;
+		int32_t y;
+		uint16_t angle;
+	};
+
+	struct QuantizedSnapshot
+	{
+		uint32_t sequence = 0;
+		std::vector<QuantizedPose> entities;
+	};
+
+	void quantize(const WorldSnapshot &snapshot, QuantizedSnapshot &out);
+	void dequantize(const QuantizedSnapshot &snapshot, WorldSnapshot &out);
+
+	// base is the last snapshot acknowledged by the receiver, nullptr for a key frame
+	void encode(const QuantizedSnapshot &snapshot, const QuantizedSnapshot *base, Packet &out);
+	// peeks sequence numbers so the receiver can find the base before decoding
+	bool decodeHeader(const Packet &packet, uint32_t &sequence, uint32_t &baseSequence);
+	bool decode(const Packet &packet, const QuantizedSnapshot *base, QuantizedSnapshot &out);
+
+	void encodeAck(uint32_t sequence, Packet &out);
+	bool decodeAck(const Packet &packet, uint32_t &sequence);
+
+	constexpr uint32_t HISTORY_SIZE = 64;
+	typedef std::array<QuantizedSnapshot, HISTORY_SIZE> History;
+}
+
+
+// Sim thread only fills a snapshot and swaps it in, encoding and I/O run on a background thread.
+class WorldStreamPublisher
+{
+public:
+	explicit WorldStreamPublisher(std::unique_ptr<StreamTransport> transport);
+	~WorldStreamPublisher();
+
+	WorldSnapshot& snapshot() { return simSnapshot; }
+	void publish();
+
+	uint64_t getBytesSent() const { return bytesSent; }
+	uint64_t getPacketsSent() const { return packetsSent; }
+
+private:
+	void run();
+	void receiveAcks();
+
+	std::unique_ptr<StreamTransport> transport;
+
+	WorldSnapshot simSnapshot;
+	WorldSnapshot pendingSnapshot;
+	WorldSnapshot workerSnapshot;
+	bool hasPending = false;
+	bool stopping = false;
+	std::mutex mutex;
+	std::condition_variable wakeUp;
+
+	world_stream::History history;
+	uint32_t sequence = 0;
+	uint32_t ackedSequence = 0;
+	Packet packet;
+	// reused, so reading acks does not allocate once it grew to an ack
+	Packet ack;
+	std::atomic<uint64_t> bytesSent;
+	std::atomic<uint64_t> packetsSent;
+
+	std::thread worker;
+};
+
+
+// Reference spectator: reconstructs the world and acknowledges every decoded snapshot
+class WorldStreamClient
+{
+public:
+	explicit WorldStreamClient(std::unique_ptr<StreamTransport> transport);
+
+	// drains received packets, returns true if the world was updated
+	bool poll();
+
+	const WorldSnapshot& getWorld() const { return world; }
+	uint32_t getSequence() const { return latestSequence; }
+
+private:
+	std::unique_ptr<StreamTransport> transport;
+	world_stream::History history;
+	uint32_t latestSequence = 0;
+	WorldSnapshot world;
+	Packet packet;
+	Packet ack;
+};
@@ -0,0 +1,107 @@
+#include "../framework/scene.hpp"
+
+
+//-------------------------------------------------------
+//	scene without a window for the tests
+//	nothing is kept or drawn, queries find nothing and the view covers
+//	the whole sea, so every aircraft steers at full detail
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr float VIEW_EXTENT = 1e6f;
+}
+
+
+namespace scene
+{
+	Mesh *createShipMesh()
+	{
+		return nullptr;
+	}
+
+	Mesh *createAircraftMesh()
+	{
+		return nullptr;
+	}
+
+	void destroyMesh( Mesh * )
+	{
+	}
+
+	void setMeshOwner( Mesh *, void * )
+	{
+	}
+
+	void *getMeshOwner( Mesh const * )
+	{
+		return nullptr;
+	}
+
+	void placeMesh( Mesh *, float, float, float )
+	{
+	}
+
+	void orbitMesh( Mesh *, float, float, float, float, float )
+	{
+	}
+
+	void attachMesh( Mesh *, Mesh *, float, float, float )
+	{
+	}
+
+	void detachMesh( Mesh * )
+	{
+	}
+
+	void placeMeshLocal( Mesh *, float, float, float )
+	{
+	}
+
+	void screenToWorld( float *x, float *y )
+	{
+		*x = ( 2.f * *x - 1.f ) * VIEW_EXTENT;
+		*y = ( 2.f * *y - 1.f ) * VIEW_EXTENT;
+	}
+
+	Mesh *pick( float, float, int )
+	{
+		return nullptr;
+	}
+
+	void queryRect( float, float, float, float, std::vector< Mesh* > &, int )
+	{
+	}
+
+	void queryRadius( float, float, float, std::vector< Mesh* > &, int )
+	{
+	}
+
+	void placeGoalMarker( float, float )
+	{
+	}
+
+	void addIsland( float, float, float )
+	{
+	}
+
+	void clearIslands()
+	{
+	}
+
+	void submitTracers( float const *, float const *, float const *, float const *, size_t )
+	{
+	}
+
+	void addFlash( float, float )
+	{
+	}
+
+	void setHudLine( int, char const *, float )
+	{
+	}
+
+	void placeCamera( float, float )
+	{
+	}
+}
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "../framework/game.hpp"
+#include "trajectory_check.hpp"
+
+
+//-------------------------------------------------------
+//	Test runner
+//	every check is a separate run, see project_linux/CMakeLists.txt:
+//	  --reference                 the game's World against reference_flight
+//	  --golden <path>             the game's World against the golden recording
+//	  --stream                    poses through the world stream
+//	  --record-golden <path>      records the golden again, only for a change
+//	                              which is meant to alter the flights
+//-------------------------------------------------------
+
+namespace game
+{
+	void log(LogLevel level, const char* text)
+	{
+		static const char* const PREFIXES[] = { "debug", "info", "error" };
+		printf("%s: %s\n", PREFIXES[level], text);
+	}
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *recordPath = nullptr;
+	const char *goldenPath = nullptr;
+	bool checkReference = false;
+	bool checkStream = false;
+	trajectory_check::Tolerance tolerance;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--reference") == 0)
+			checkReference = true;
+		else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc)
+			goldenPath = argv[++i];
+		else if (strcmp(argv[i], "--stream") == 0)
+			checkStream = true;
+		else if (strcmp(argv[i], "--record-golden") == 0 && i + 1 < argc)
+			recordPath = argv[++i];
+		else if (strcmp(argv[i], "--position-tolerance") == 0 && i + 1 < argc)
+			tolerance.position = static_cast<float>(atof(argv[++i]));
+		else if (strcmp(argv[i], "--angle-tolerance") == 0 && i + 1 < argc)
+			tolerance.angle = static_cast<float>(atof(argv[++i]));
+		else
+		{
+			printf("unknown argument %s\n", argv[i]);
+			return 2;
+		}
+	}
+
+	if (recordPath)
+		return trajectory_check::recordGolden(recordPath);
+	if (goldenPath)
+		return trajectory_check::checkGolden(goldenPath, tolerance);
+	if (checkReference)
+		return trajectory_check::checkReference(tolerance);
+	if (checkStream)
+		return trajectory_check::checkStream();
+	printf("usage: %s --reference | --golden <path> | --stream | --record-golden <path>\n", argv[0]);
+	return 2;
+}
@@ -0,0 +1,731 @@
+#include "reference_flight.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+
+namespace
+{
+	using reference_flight::Model;
+
+	constexpr float POS_EPS = 0.1f;
+	constexpr float DECK_FRONT = 0.4f;
+	constexpr float MAX_CHORD_ANGLE = 0.2f;
+	constexpr float ORBIT_ENTRY_COS = 0.1f;
+	constexpr float RETURN_RESERVE_SEC = 1.f;
+	constexpr double MIN_LOITER_SLEEP_SEC = 0.1;
+	constexpr uint16_t IDS_PER_SHIP = params::ship::AICRAFTS_COUNT + 1;
+
+	template<class FlightModel>
+	constexpr Model modelOf()
+	{
+		return Model{ FlightModel::LINEAR_SPEED, FlightModel::ACCELERATION, FlightModel::ANGULAR_SPEED,
+					  FlightModel::FLIGHT_TIME_SEC, FlightModel::FUELING_TIME_SEC, FlightModel::FLYBY_DISTANCE };
+	}
+
+	// in the order AirWing tries squadrons on a launch
+	constexpr Model FIGHTER = modelOf<flight_model::Fighter>();
+	constexpr Model TANKER = modelOf<flight_model::Tanker>();
+	constexpr Model AWACS = modelOf<flight_model::Awacs>();
+	constexpr const Model* MODELS[] = { &FIGHTER, &TANKER, &AWACS };
+
+
+	//-------------------------------------------------------
+	//	steering, as it was when the reference was taken
+	//-------------------------------------------------------
+
+	float turnRadius(float speed, float angularSpeed)
+	{
+		return fabs(speed / angularSpeed);
+	}
+
+	Vector2 centerOfTurn(Vector2 position, float angle, float speed, float angularSpeed)
+	{
+		const float normalAngle = angularSpeed > 0 ? angle + math::PI / 2 : angle - math::PI / 2;
+		Vector2 normal{cosf(normalAngle), sinf(normalAngle)};
+		const float r = turnRadius(speed, angularSpeed);
+		normal = r*normal;
+		return position + normal;
+	}
+
+	bool isPointInCircle(Vector2 point, Vector2 center, float r)
+	{
+		const Vector2 diff = point - center;
+		return diff.length() <= r;
+	}
+
+	Vector2 windCorrectedAim(Vector2 position, Vector2 target, Vector2 wind, float speed)
+	{
+		const float flightTime = (target - position).length() / speed;
+		return target - flightTime * wind;
+	}
+
+	float pursue(Vector2 position, float angle, Vector2 aim, float leaderAngularSpeed, float maxAngularSpeed)
+	{
+		const Vector2 direction = aim - position;
+		const float distance = direction.length();
+		if (math::isZero(distance))
+			return leaderAngularSpeed;
+
+		const Vector2 heading = Vector2::fromAngle(angle);
+		const float sinError = cross(heading, direction) / distance;
+		if (dot(heading, direction) < 0)
+			return sinError >= 0 ? maxAngularSpeed : -maxAngularSpeed;
+		return math::clamp(leaderAngularSpeed + params::formation::TURN_GAIN * sinError, -maxAngularSpeed, maxAngularSpeed);
+	}
+
+	float toTarget(Vector2 position, float angle, float speed, float angularSpeed, Vector2 target, float maxAngularSpeed)
+	{
+		const Vector2 targetDirection = target - position;
+		if (targetDirection.isZero())
+			return angularSpeed;
+
+		const float targetAngle = atan2f(targetDirection.y, targetDirection.x);
+		const float diff = targetAngle - angle;
+		if (math::isEqual(cosf(diff), 1))
+			return 0;
+		if (math::isAbsEqual(diff, math::PI))
+			return maxAngularSpeed;
+
+		const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
+		angularSpeed = sign * maxAngularSpeed;
+
+		// target inside of the turn is reached by turning the other way
+		const float r = turnRadius(speed, angularSpeed);
+		const Vector2 center = centerOfTurn(position, angle, speed, angularSpeed);
+		if (isPointInCircle(target, center, r - POS_EPS))
+			angularSpeed = -angularSpeed;
+		return angularSpeed;
+	}
+
+	float aroundTarget(Vector2 position, float angle, Vector2 target, float flybyRadius, float maxAngularSpeed)
+	{
+		const float r = flybyRadius;
+		if (isPointInCircle(position, target, r-POS_EPS))
+			return 0;
+
+		const Vector2 direction = target - position;
+		const float targetAngle = atan2f(direction.y, direction.x);
+		const float directionTangentAngle = asinf(r / direction.length());
+		if (math::isZero(directionTangentAngle))
+			return 0;
+
+		const float desiredAngle = cosf(targetAngle - directionTangentAngle - angle) > cosf(targetAngle + directionTangentAngle - angle) ?
+			targetAngle - directionTangentAngle :
+			targetAngle + directionTangentAngle;
+
+		const float diff = desiredAngle - angle;
+		if (math::isEqual(cosf(diff), 1))
+			return 0;
+		const float sign = sinf(diff) >= 0 ? 1.f : -1.f;
+		return sign * maxAngularSpeed;
+	}
+
+	float closestApproach(Vector2 from, Vector2 to)
+	{
+		const Vector2 direction = to - from;
+		const float lengthSquared = direction.lengthSquared();
+		float t = 0.f;
+		if (lengthSquared > 0.f)
+		{
+			t = -dot(from, direction) / lengthSquared;
+			t = t < 0.f ? 0.f : (t > 1.f ? 1.f : t);
+		}
+		return (from + t * direction).length();
+	}
+
+	void advanceOnArc(Vector2 &position, float &angle, float speed, float angularSpeed, float dt)
+	{
+		const float newAngle = angle + angularSpeed * dt;
+		if (fabs(angularSpeed * dt) < 1e-4f)
+		{
+			position = position + speed * dt * Vector2::fromAngle(newAngle);
+		}
+		else
+		{
+			const float r = speed / angularSpeed;
+			position = position + r * Vector2(std::sin(newAngle) - std::sin(angle), std::cos(angle) - std::cos(newAngle));
+		}
+		angle = math::scopedAngle(newAngle);
+	}
+
+	Vector2 formationSlot(int index)
+	{
+		const float row = static_cast<float>(index / 2 + 1);
+		const float side = index % 2 == 0 ? -1.f : 1.f;
+		return params::formation::SLOT_SPACING * Vector2(-row, side * row);
+	}
+}
+
+
+namespace reference_flight
+{
+	//-------------------------------------------------------
+	//	Aircraft
+	//-------------------------------------------------------
+
+	void Aircraft::init(const Model &modelArg, Carrier &carrierArg, int sideNumber)
+	{
+		model = &modelArg;
+		carrier = &carrierArg;
+		number = sideNumber;
+		state = AicraftState::Ready;
+		flybyRadius = turnRadius(model->linearSpeed, model->angularSpeed) + model->flybyDistance * number;
+	}
+
+
+	void Aircraft::launch()
+	{
+		state = AicraftState::Takeoff;
+		position = carrier->getPosition();
+		shipPosition = 0;
+		angle = carrier->getAngle();
+		speed = 0;
+		angularSpeed = 0;
+		nextStateTime = carrier->getTime() + model->flightTimeSec;
+		leader = nullptr;
+		slot = Vector2();
+		followersCount = 0;
+	}
+
+
+	void Aircraft::newTarget(Vector2 targetPosition)
+	{
+		leaveOrbit();
+		target = targetPosition;
+	}
+
+
+	void Aircraft::step(float dt, const WindField &windField)
+	{
+		const bool airborne = state == AicraftState::Takeoff || state == AicraftState::MovingToTarget ||
+			state == AicraftState::MovingToBase;
+		if (airborne && !orbiting)
+			wind = windField.sample(position, carrier->getTime());
+
+		switch (state)
+		{
+		case AicraftState::Takeoff:
+			takeOff(dt);
+			break;
+		case AicraftState::MovingToTarget:
+			if (orbiting)
+				loiter();
+			else
+				flyAroundTarget(dt);
+			break;
+		case AicraftState::MovingToBase:
+			flyToShip(dt);
+			break;
+		default:
+			break;
+		}
+	}
+
+
+	Vector2 Aircraft::getPosition() const
+	{
+		if (!orbiting)
+			return position;
+		return target + orbitRadius * Vector2::fromAngle(orbitPhase());
+	}
+
+
+	float Aircraft::getAngle() const
+	{
+		if (!orbiting)
+			return angle;
+		return math::scopedAngle(orbitPhase() + (orbitRate > 0 ? math::PI / 2 : -math::PI / 2));
+	}
+
+
+	float Aircraft::orbitPhase() const
+	{
+		return orbitStartPhase + orbitRate * static_cast<float>(carrier->getTime() - orbitStartTime);
+	}
+
+
+	// the step which passes the bow is finished in the air
+	void Aircraft::takeOff(float dt)
+	{
+		accelerate(dt);
+		const float deckLeft = DECK_FRONT - shipPosition;
+		const float rollDistance = speed * dt;
+		if (rollDistance <= deckLeft)
+		{
+			shipPosition += rollDistance;
+			position = carrier->localToGlobal(shipPosition);
+			angle = carrier->getAngle();
+			return;
+		}
+
+		shipPosition = DECK_FRONT;
+		position = carrier->localToGlobal(shipPosition);
+		angle = carrier->getAngle();
+		angularSpeed = 0;
+		state = AicraftState::MovingToTarget;
+		move(deckLeft > 0.f ? dt - deckLeft / speed : dt);
+	}
+
+
+	void Aircraft::flyAroundTarget(float dt)
+	{
+		if (isTimeToGoToBase(distanceToShip()))
+		{
+			leaveFormation();
+			state = AicraftState::MovingToBase;
+			flyToShip(dt);
+			return;
+		}
+
+		if (leader && !keepsFormation())
+			leaveFormation();
+		if (leader)
+		{
+			flyInFormation(dt);
+			return;
+		}
+
+		accelerate(dt);
+		const Vector2 aim = windCorrectedAim(position, target, wind, speed);
+		angularSpeed = aroundTarget(position, angle, aim, flybyRadius, model->angularSpeed);
+		move(dt);
+		tryEnterOrbit();
+	}
+
+
+	void Aircraft::flyInFormation(float dt)
+	{
+		const Vector2 forward = Vector2::fromAngle(leader->getAngle());
+		const Vector2 place = leader->getPosition() + slot.x * forward + slot.y * forward.perpendicular();
+		angularSpeed = pursue(position, angle, place + params::formation::LEAD_DISTANCE * forward,
+							  leader->getAngularSpeed(), model->angularSpeed);
+
+		const float gap = dot(place - position, forward);
+		const float wantedSpeed = math::clamp(leader->speed + params::formation::CATCH_UP_GAIN * gap,
+											  model->linearSpeed * (1.f - params::formation::CATCH_UP_RATIO),
+											  model->linearSpeed * (1.f + params::formation::CATCH_UP_RATIO));
+		const float speedStep = (1.f + params::formation::CATCH_UP_RATIO) * model->acceleration * dt;
+		speed += math::clamp(wantedSpeed - speed, -speedStep, speedStep);
+		move(dt);
+	}
+
+
+	// the orbit is left at the end of the frame it is decided in, the way home starts with the next one
+	void Aircraft::loiter()
+	{
+		if (carrier->getTime() < returnCheckTime)
+			return;
+		if (isTimeToGoToBase(distanceToShip()))
+		{
+			leaveOrbit();
+			state = AicraftState::MovingToBase;
+			return;
+		}
+		returnCheckTime = returnTime();
+	}
+
+
+	void Aircraft::flyToShip(float dt)
+	{
+		accelerate(dt);
+		const Vector2 aim = windCorrectedAim(position, carrier->getFlowField().waypoint(position), wind, speed);
+		angularSpeed = toTarget(position, angle, speed, angularSpeed, aim, model->angularSpeed);
+		if (move(dt))
+			onLanded();
+	}
+
+
+	void Aircraft::accelerate(float dt)
+	{
+		if (speed < model->linearSpeed)
+		{
+			speed += model->acceleration * dt;
+			if (speed > model->linearSpeed)
+				speed = model->linearSpeed;
+		}
+		else if (speed > model->linearSpeed)
+		{
+			speed = std::max(speed - model->acceleration * dt, model->linearSpeed);
+		}
+	}
+
+
+	bool Aircraft::move(float dt)
+	{
+		const Vector2 from = position;
+		const float fromAngle = angle;
+		advanceOnArc(position, angle, speed, angularSpeed, dt);
+		position = position + dt * wind;
+		return state == AicraftState::MovingToBase && isShipReached(from, fromAngle, dt);
+	}
+
+
+	void Aircraft::onLanded()
+	{
+		state = AicraftState::Fueling;
+		nextStateTime = carrier->getTime() + model->fuelingTimeSec;
+	}
+
+
+	void Aircraft::tryEnterOrbit()
+	{
+		if (state != AicraftState::MovingToTarget || speed != model->linearSpeed)
+			return;
+
+		const Vector2 radial = position - target;
+		const float distance = radial.length();
+		if (fabs(distance - flybyRadius) > POS_EPS)
+			return;
+
+		const Vector2 heading = Vector2::fromAngle(angle);
+		if (fabs(dot(radial, heading) / distance) > ORBIT_ENTRY_COS)
+			return;
+
+		const float direction = cross(radial, heading) > 0 ? 1.f : -1.f;
+		orbitRadius = radial.length();
+		orbitStartPhase = atan2f(radial.y, radial.x);
+		orbitRate = direction * speed / distance;
+		orbitStartTime = carrier->getTime();
+		returnCheckTime = orbitStartTime;
+		orbiting = true;
+	}
+
+
+	void Aircraft::leaveOrbit()
+	{
+		if (!orbiting)
+			return;
+		position = getPosition();
+		angle = getAngle();
+		angularSpeed = orbitRate;
+		orbiting = false;
+	}
+
+
+	bool Aircraft::joinFormation(Aircraft &leaderArg)
+	{
+		if (!leaderArg.canLead())
+			return false;
+		const int index = leaderArg.followersCount++;
+		leaderArg.followers[index] = this;
+		leader = &leaderArg;
+		slot = formationSlot(index);
+		return true;
+	}
+
+
+	bool Aircraft::canLead() const
+	{
+		return !leader && followersCount < params::formation::MAX_FOLLOWERS && !orbiting &&
+			(state == AicraftState::Takeoff || state == AicraftState::MovingToTarget) &&
+			(position - carrier->getPosition()).length() < params::formation::JOIN_DISTANCE;
+	}
+
+
+	bool Aircraft::keepsFormation() const
+	{
+		return !leader->orbiting && leader->state == AicraftState::MovingToTarget &&
+			(leader->position - leader->target).length() > leader->flybyRadius + params::formation::BREAK_DISTANCE;
+	}
+
+
+	void Aircraft::leaveFormation()
+	{
+		if (!leader)
+			return;
+		Aircraft **end = leader->followers + leader->followersCount;
+		Aircraft **place = std::find(leader->followers, end, this);
+		if (place != end)
+		{
+			for (Aircraft **next = place + 1; next != end; ++place, ++next)
+			{
+				*place = *next;
+				(*place)->slot = formationSlot(static_cast<int>(place - leader->followers));
+			}
+			leader->followers[--leader->followersCount] = nullptr;
+		}
+		leader = nullptr;
+		angularSpeed = 0;
+	}
+
+
+	bool Aircraft::isShipReached(Vector2 from, float fromAngle, float dt) const
+	{
+		const int chords = 1 + static_cast<int>(fabs(angularSpeed * dt) / MAX_CHORD_ANGLE);
+		const Vector2 shipFrom = carrier->getPreviousPosition();
+		const Vector2 shipStep = carrier->getPosition() - shipFrom;
+		const float chordTime = dt / chords;
+
+		Vector2 chordStart = from;
+		float chordAngle = fromAngle;
+		for (int i = 1; i <= chords; ++i)
+		{
+			Vector2 chordEnd = chordStart;
+			if (i == chords)
+				chordEnd = position;
+			else
+			{
+				advanceOnArc(chordEnd, chordAngle, speed, angularSpeed, chordTime);
+				chordEnd = chordEnd + chordTime * wind;
+			}
+
+			const Vector2 relativeFrom = chordStart - (shipFrom + (float(i - 1) / chords) * shipStep);
+			const Vector2 relativeTo = chordEnd - (shipFrom + (float(i) / chords) * shipStep);
+			if (closestApproach(relativeFrom, relativeTo) < POS_EPS)
+				return true;
+			chordStart = chordEnd;
+		}
+		return false;
+	}
+
+
+	float Aircraft::distanceToShip() const
+	{
+		const FlowField &flowField = carrier->getFlowField();
+		if (orbiting)
+			return flowField.pathLength(target) + orbitRadius;
+		return flowField.pathLength(position);
+	}
+
+
+	bool Aircraft::isTimeToGoToBase(float distanceToShip) const
+	{
+		const float turnRate = orbiting ? orbitRate :
+			(angularSpeed != 0 && !leader ? angularSpeed : model->angularSpeed);
+		const float circleLength = 2.f*math::PI * turnRadius(speed, turnRate);
+		const float distance = circleLength + distanceToShip;
+		const double needTime = distance / fabs(speed);
+		return carrier->getTime() + needTime + RETURN_RESERVE_SEC > nextStateTime;
+	}
+
+
+	// earliest time the loitering aircraft may have to go back, assuming the ship sails away at full speed
+	double Aircraft::returnTime() const
+	{
+		const double now = carrier->getTime();
+		const double circleLength = 2.f*math::PI * orbitRadius;
+		const double shipSpeedRatio = params::ship::LINEAR_SPEED / speed;
+		const double time = (nextStateTime - RETURN_RESERVE_SEC - (circleLength + distanceToShip()) / speed + shipSpeedRatio * now) /
+			(1.0 + shipSpeedRatio);
+		return std::max(time, now + MIN_LOITER_SLEEP_SEC);
+	}
+
+
+	void Aircraft::collectPose(WorldSnapshot &snapshot, uint16_t idBase) const
+	{
+		const Vector2 pose = getPosition();
+		snapshot.entities.push_back(EntityPose{ static_cast<uint16_t>(idBase + number), EntityKind::Aicraft, state,
+			pose.x, pose.y, getAngle(), speed, getAngularSpeed() });
+	}
+
+
+	//-------------------------------------------------------
+	//	Carrier
+	//-------------------------------------------------------
+
+	void Carrier::init(Vector2 startPosition, float startAngle, const WingLayout &wing)
+	{
+		position = startPosition;
+		previousPosition = position;
+		angle = startAngle;
+		time = 0;
+		releaseKeys();
+		// aircrafts point to each other, the vector is never grown after this
+		aicrafts.clear();
+		aicrafts.reserve(wing.fighters + wing.tankers + wing.awacs);
+		squadrons.assign(sizeof(MODELS) / sizeof(MODELS[0]), Squadron());
+		int sideNumber = 0;
+		addAicrafts(FIGHTER, wing.fighters, sideNumber);
+		addAicrafts(TANKER, wing.tankers, sideNumber);
+		addAicrafts(AWACS, wing.awacs, sideNumber);
+	}
+
+
+	void Carrier::addAicrafts(const Model &model, int count, int &sideNumber)
+	{
+		const size_t index = std::find(std::begin(MODELS), std::end(MODELS), &model) - std::begin(MODELS);
+		for (int i = 0; i < count; ++i)
+		{
+			aicrafts.emplace_back();
+			aicrafts.back().init(model, *this, ++sideNumber);
+			squadrons[index].ready.push_back(&aicrafts.back());
+		}
+	}
+
+
+	void Carrier::step(float dt, const NavigationMap &map)
+	{
+		linearSpeed = 0.f;
+		angularSpeed = 0.f;
+
+		if (input[game::KEY_FORWARD])
+			linearSpeed = params::ship::LINEAR_SPEED;
+		else if (input[game::KEY_BACKWARD])
+			linearSpeed = -params::ship::LINEAR_SPEED;
+
+		if (input[game::KEY_LEFT] && linearSpeed != 0.f)
+			angularSpeed = params::ship::ANGULAR_SPEED;
+		else if (input[game::KEY_RIGHT] && linearSpeed != 0.f)
+			angularSpeed = -params::ship::ANGULAR_SPEED;
+
+		time += dt;
+		previousPosition = position;
+		angle = angle + angularSpeed * dt;
+		position = position + linearSpeed * dt * Vector2::fromAngle(angle);
+		flowField.update(position, map);
+	}
+
+
+	void Carrier::stepAircrafts(float dt, const WindField &windField)
+	{
+		for (Aircraft &aicraft : aicrafts)
+		{
+			if (!aicraft.isInFormation())
+				aicraft.step(dt, windField);
+		}
+
+		// followers which leave move the ones behind up a slot, so the group is taken as it was
+		for (Aircraft &aicraft : aicrafts)
+		{
+			Aircraft *group[params::formation::MAX_FOLLOWERS];
+			const int count = aicraft.getFollowersCount();
+			for (int i = 0; i < count; ++i)
+				group[i] = aicraft.getFollower(i);
+			for (int i = 0; i < count; ++i)
+				group[i]->step(dt, windField);
+		}
+
+		// the hangar takes them by the time they got ready
+		fueled.clear();
+		for (Aircraft &aicraft : aicrafts)
+		{
+			if (aicraft.getState() == AicraftState::Fueling && time >= aicraft.getNextStateTime())
+				fueled.push_back(&aicraft);
+		}
+		std::stable_sort(fueled.begin(), fueled.end(),
+						 [](const Aircraft *left, const Aircraft *right) { return left->getNextStateTime() < right->getNextStateTime(); });
+		for (Aircraft *aicraft : fueled)
+		{
+			aicraft->makeReady();
+			const size_t index = std::find(std::begin(MODELS), std::end(MODELS), &aicraft->getModel()) - std::begin(MODELS);
+			squadrons[index].ready.push_back(aicraft);
+		}
+	}
+
+
+	void Carrier::releaseKeys()
+	{
+		for (bool &key : input)
+			key = false;
+	}
+
+
+	void Carrier::setTarget(Vector2 worldPosition)
+	{
+		for (Aircraft &aicraft : aicrafts)
+			aicraft.newTarget(worldPosition);
+	}
+
+
+	void Carrier::tryLaunchAicraft()
+	{
+		for (Squadron &squadron : squadrons)
+		{
+			if (squadron.ready.empty())
+				continue;
+			Aircraft *aicraft = squadron.ready.front();
+			squadron.ready.erase(squadron.ready.begin());
+			aicraft->launch();
+			if (!squadron.leader || !aicraft->joinFormation(*squadron.leader))
+				squadron.leader = aicraft;
+			return;
+		}
+	}
+
+
+	Vector2 Carrier::localToGlobal(float localPosition) const
+	{
+		return position + localPosition*Vector2::fromAngle(angle);
+	}
+
+
+	void Carrier::collectPoses(WorldSnapshot &snapshot, uint16_t idBase) const
+	{
+		snapshot.entities.push_back(EntityPose{ idBase, EntityKind::Ship, AicraftState::NotReady, position.x, position.y, angle,
+			linearSpeed, angularSpeed });
+		for (const Aircraft &aicraft : aicrafts)
+			aicraft.collectPose(snapshot, idBase);
+	}
+
+
+	//-------------------------------------------------------
+	//	World
+	//-------------------------------------------------------
+
+	void World::init(const WingLayout &wing)
+	{
+		assert(carriers.empty());
+		wind.init(params::wind::SEED);
+		navigation.init(params::navigation::SEED);
+		for (int i = 0; i < params::world::SHIPS_COUNT; ++i)
+		{
+			carriers.push_back(std::make_unique<Carrier>());
+			carriers.back()->init(Vector2(0.f, -params::world::SHIP_SPACING * i), 0.f, wing);
+		}
+		selected = 0;
+	}
+
+
+	void World::deinit()
+	{
+		carriers.clear();
+		navigation.deinit();
+	}
+
+
+	void World::update(float dt)
+	{
+		for (auto &carrier : carriers)
+			carrier->step(dt, navigation);
+		for (auto &carrier : carriers)
+			carrier->stepAircrafts(dt, wind);
+	}
+
+
+	void World::keyPressed(int key)
+	{
+		if (key == game::KEY_NEXT_SHIP)
+		{
+			carriers[selected]->releaseKeys();
+			selected = (selected + 1) % carriers.size();
+			return;
+		}
+		if (key != game::KEY_RECALL)
+			carriers[selected]->keyPressed(key);
+	}
+
+
+	void World::keyReleased(int key)
+	{
+		if (key != game::KEY_NEXT_SHIP && key != game::KEY_RECALL)
+			carriers[selected]->keyReleased(key);
+	}
+
+
+	void World::mouseClicked(Vector2 worldPosition, bool isLeftButton)
+	{
+		if (isLeftButton)
+			carriers[selected]->setTarget(worldPosition);
+		else
+			carriers[selected]->tryLaunchAicraft();
+	}
+
+
+	void World::collectPoses(WorldSnapshot &snapshot) const
+	{
+		for (size_t i = 0; i < carriers.size(); ++i)
+			carriers[i]->collectPoses(snapshot, static_cast<uint16_t>(i * IDS_PER_SHIP));
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "../game_cpp/navigation.hpp"
+#include "../game_cpp/ship.hpp"
+#include "../game_cpp/wind_field.hpp"
+#include "../game_cpp/world_stream.hpp"
+
+#include <memory>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Reference flight
+//	a frozen copy of the carrier and aircraft step in its plain form: every
+//	frame every carrier moves, then every aircraft runs the part of its sortie
+//	its state says and steers again, one after another. No scheduling, no
+//	sleeping, no detail tiers. The game's World is checked against it frame by
+//	frame, see trajectory_check; change it only together with the flight
+//	behaviour, never to make it faster.
+//	Islands, flow fields and wind are the game's own, the copy is of what
+//	aircrafts and carriers do with them. Recalls are left out, they need the
+//	scene to find aircrafts in the view, and so are bursts, they do not move anybody.
+//-------------------------------------------------------
+
+namespace reference_flight
+{
+	// constants of a flight model, read at run time by the one step every model shares
+	struct Model
+	{
+		float linearSpeed;
+		float acceleration;
+		float angularSpeed;
+		int flightTimeSec;
+		int fuelingTimeSec;
+		float flybyDistance;
+	};
+
+	class Carrier;
+
+	class Aircraft
+	{
+	public:
+		void init(const Model &model, Carrier &carrier, int sideNumber);
+		void launch();
+		void newTarget(Vector2 targetPosition);
+		// one frame of the sortie, the carrier has already moved in it
+		void step(float dt, const WindField &windField);
+
+		bool joinFormation(Aircraft &leader);
+		void collectPose(WorldSnapshot &snapshot, uint16_t idBase) const;
+
+		const Model& getModel() const { return *model; }
+		AicraftState getState() const { return state; }
+		double getNextStateTime() const { return nextStateTime; }
+		bool isInFormation() const { return leader != nullptr; }
+		int getFollowersCount() const { return followersCount; }
+		Aircraft* getFollower(int index) const { return followers[index]; }
+		// fueled, waits in the hangar for a launch
+		void makeReady() { state = AicraftState::Ready; }
+
+	private:
+		Vector2 getPosition() const;
+		float getAngle() const;
+		float getAngularSpeed() const { return orbiting ? orbitRate : angularSpeed; }
+		float orbitPhase() const;
+
+		void takeOff(float dt);
+		void flyAroundTarget(float dt);
+		void flyInFormation(float dt);
+		void loiter();
+		void flyToShip(float dt);
+		void accelerate(float dt);
+		bool move(float dt);
+		void onLanded();
+		void tryEnterOrbit();
+		void leaveOrbit();
+		bool canLead() const;
+		bool keepsFormation() const;
+		void leaveFormation();
+		bool isShipReached(Vector2 from, float fromAngle, float dt) const;
+		float distanceToShip() const;
+		bool isTimeToGoToBase(float distanceToShip) const;
+		double returnTime() const;
+
+		const Model *model = nullptr;
+		Carrier *carrier = nullptr;
+		int number = 0;
+		AicraftState state = AicraftState::NotReady;
+		Vector2 position;
+		float shipPosition = 0;
+		Vector2 target;
+		double nextStateTime = 0;
+		float angle = 0;
+		float speed = 0;
+		float angularSpeed = 0;
+		float flybyRadius = 0;
+		Vector2 wind;
+
+		bool orbiting = false;
+		float orbitRadius = 0;
+		float orbitStartPhase = 0;
+		float orbitRate = 0;
+		double orbitStartTime = 0;
+		double returnCheckTime = 0;
+
+		Aircraft *leader = nullptr;
+		Vector2 slot;
+		Aircraft *followers[params::formation::MAX_FOLLOWERS] = {};
+		int followersCount = 0;
+	};
+
+
+	class Carrier
+	{
+	public:
+		void init(Vector2 startPosition, float startAngle, const WingLayout &wing);
+		void step(float dt, const NavigationMap &map);
+		// leaders go first, so their followers see where they are after this frame
+		void stepAircrafts(float dt, const WindField &windField);
+
+		void keyPressed(int key) { input[key] = true; }
+		void keyReleased(int key) { input[key] = false; }
+		void releaseKeys();
+		void setTarget(Vector2 worldPosition);
+		void tryLaunchAicraft();
+		void collectPoses(WorldSnapshot &snapshot, uint16_t idBase) const;
+
+		const Vector2& getPosition() const { return position; }
+		const Vector2& getPreviousPosition() const { return previousPosition; }
+		float getAngle() const { return angle; }
+		double getTime() const { return time; }
+		const FlowField& getFlowField() const { return flowField; }
+		Vector2 localToGlobal(float localPosition) const;
+
+	private:
+		// aircrafts of one model: the ones in the hangar by the time they got ready, and the last one launched on its own
+		struct Squadron
+		{
+			std::vector<Aircraft*> ready;
+			Aircraft *leader = nullptr;
+		};
+
+		void addAicrafts(const Model &model, int count, int &sideNumber);
+
+		Vector2 position;
+		Vector2 previousPosition;
+		float angle = 0;
+		float linearSpeed = 0;
+		float angularSpeed = 0;
+		double time = 0;
+		bool input[game::KEY_COUNT];
+		FlowField flowField;
+		// by side number, which goes model by model
+		std::vector<Aircraft> aicrafts;
+		std::vector<Squadron> squadrons;
+		std::vector<Aircraft*> fueled;
+	};
+
+
+	// same calls as World, which the scenarios of trajectory_check drive
+	class World
+	{
+	public:
+		void init(const WingLayout &wing = WingLayout());
+		void deinit();
+		void update(float dt);
+		void keyPressed(int key);
+		void keyReleased(int key);
+		// there is no scene to pick a carrier in, left clicks always set the target
+		void mouseClicked(Vector2 worldPosition, bool isLeftButton);
+
+		// ids and order as World::collectPoses gives them
+		void collectPoses(WorldSnapshot &snapshot) const;
+
+	private:
+		std::vector<std::unique_ptr<Carrier>> carriers;
+		size_t selected = 0;
+		WindField wind;
+		NavigationMap navigation;
+	};
+}
@@ -0,0 +1,511 @@
+#include "trajectory_check.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <thread>
+
+#include "../framework/latency_tracker.hpp"
+#include "../game_cpp/world.hpp"
+#include "reference_flight.hpp"
+
+namespace
+{
+	constexpr float STEP = 1.f / 60.f;
+	constexpr char MAGIC[8] = { 'W', 'O', 'T', 'S', 'T', 'R', 'J', '2' };
+	// the golden recording keeps a frame a second: a flight which went another way stays off for longer than that,
+	// and the file is small enough for the repository
+	constexpr int GOLDEN_FRAME_STEP = 60;
+	// id, kind, state, x, y and angle as save writes them
+	constexpr size_t ENTITY_RECORD_SIZE = sizeof(uint16_t) + 2 * sizeof(uint8_t) + 3 * sizeof(float);
+
+	// inputs go through the same World calls the player's clicks and keys end up in
+	struct Command
+	{
+		enum Type
+		{
+			Click,
+			Launch,
+			KeyDown,
+			KeyUp
+		};
+
+		float time;
+		Type type;
+		Vector2 position;
+		int key;
+	};
+
+	struct Scenario
+	{
+		const char *name;
+		float duration;
+		std::vector<Command> commands;
+		WingLayout wing;
+	};
+
+	Command click(float time, float x, float y) { return Command{ time, Command::Click, Vector2(x, y), 0 }; }
+	Command launch(float time) { return Command{ time, Command::Launch, Vector2(), 0 }; }
+	Command keyDown(float time, int key) { return Command{ time, Command::KeyDown, Vector2(), key }; }
+	Command keyUp(float time, int key) { return Command{ time, Command::KeyUp, Vector2(), key }; }
+
+	// a full fighter cycle, then carriers sailing and turning under loitering aircrafts,
+	// a new target and a second carrier; the mixed wing flies every model from the same carrier
+	const std::vector<Scenario>& scenarios()
+	{
+		static const std::vector<Scenario> all = {
+			{ "sortie", 200.f, {
+				click(0.f, 4.f, 3.f),
+				launch(0.f), launch(0.5f), launch(1.f), launch(1.5f), launch(2.f) } },
+			{ "maneuvers", 180.f, {
+				click(0.f, -6.f, 8.f),
+				keyDown(0.f, game::KEY_FORWARD),
+				launch(0.f), launch(0.5f), launch(1.f), launch(1.5f), launch(2.f),
+				keyDown(5.f, game::KEY_LEFT), keyUp(12.f, game::KEY_LEFT),
+				click(40.f, 8.f, 10.f),
+				keyDown(60.f, game::KEY_RIGHT), keyUp(70.f, game::KEY_RIGHT),
+				keyDown(80.f, game::KEY_NEXT_SHIP),
+				click(80.f, -3.f, -12.f),
+				launch(80.5f), launch(81.f), launch(81.5f) } },
+			{ "mixed wing", 260.f, {
+				click(0.f, 5.f, -4.f),
+				launch(0.f), launch(0.5f), launch(1.f), launch(1.5f), launch(2.f) },
+				WingLayout{ 3, 1, 1 } },
+		};
+		return all;
+	}
+
+	template<class SimWorld>
+	void execute(SimWorld &world, const Command &command)
+	{
+		switch (command.type)
+		{
+		case Command::Click:
+			world.mouseClicked(command.position, true);
+			break;
+		case Command::Launch:
+			world.mouseClicked(command.position, false);
+			break;
+		case Command::KeyDown:
+			world.keyPressed(command.key);
+			break;
+		case Command::KeyUp:
+			world.keyReleased(command.key);
+			break;
+		}
+	}
+
+	latency_tracker::Source latencySource(const Command &command)
+	{
+		return command.type == Command::Click || command.type == Command::Launch ? latency_tracker::SOURCE_MOUSE
+																				  : latency_tracker::SOURCE_KEY;
+	}
+
+	int framesCount(const Scenario &scenario)
+	{
+		return static_cast<int>(scenario.duration / STEP);
+	}
+
+	// runs the scenario from fresh worlds, every one of them gets each command and update in turn;
+	// onFrame(frame) is called after every update. Commands go through the latency tracker
+	// like the player's input; nothing is drawn, so a frame counts as drawn and presented
+	// once onFrame has taken its poses
+	template<class OnFrame, class... SimWorlds>
+	void play(const Scenario &scenario, OnFrame onFrame, SimWorlds&... worlds)
+	{
+		using expand = int[];
+		(void)expand{ 0, (worlds.init(scenario.wing), 0)... };
+		size_t next = 0;
+		const int frames = framesCount(scenario);
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			const float time = frame * STEP;
+			while (next < scenario.commands.size() && scenario.commands[next].time <= time)
+			{
+				const Command &command = scenario.commands[next++];
+				latency_tracker::dispatched(latency_tracker::inputReceived(latencySource(command)));
+				(void)expand{ 0, (execute(worlds, command), 0)... };
+			}
+			(void)expand{ 0, (worlds.update(STEP), 0)... };
+			latency_tracker::updated();
+			onFrame(frame);
+			const uint32_t shown = latency_tracker::lastUpdated();
+			latency_tracker::drawn(shown);
+			latency_tracker::presented(shown);
+		}
+		(void)expand{ 0, (worlds.deinit(), 0)... };
+	}
+
+	const Scenario* findScenario(const std::string &name)
+	{
+		for (const Scenario &scenario : scenarios())
+		{
+			if (name == scenario.name)
+				return &scenario;
+		}
+		return nullptr;
+	}
+
+	trajectory_check::Recording run(const Scenario &scenario, int frameStep)
+	{
+		trajectory_check::Recording recording;
+		recording.scenario = scenario.name;
+		recording.frameStep = frameStep;
+		recording.frames.resize((framesCount(scenario) + frameStep - 1) / frameStep);
+		World world;
+		play(scenario, [&recording, &world, frameStep](int frame)
+		{
+			if (frame % frameStep == 0)
+				world.collectPoses(recording.frames[frame / frameStep]);
+		}, world);
+		return recording;
+	}
+
+	// the publisher encodes on its own thread, the client sees the snapshot once that is done
+	bool awaitSequence(WorldStreamClient &client, uint32_t sequence)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+		while (client.getSequence() < sequence)
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+				return false;
+			if (!client.poll())
+				std::this_thread::yield();
+		}
+		return client.getSequence() == sequence;
+	}
+
+	// aircrafts on deck or in the hangar keep the pose they landed with, it is not compared
+	bool isFlying(const EntityPose &pose)
+	{
+		return pose.kind == EntityKind::Ship || pose.state == AicraftState::Takeoff ||
+			pose.state == AicraftState::MovingToTarget || pose.state == AicraftState::MovingToBase;
+	}
+
+	float angleDifference(float from, float to)
+	{
+		const float difference = std::fmod(to - from, 2.f * math::PI);
+		if (difference > math::PI)
+			return difference - 2.f * math::PI;
+		if (difference < -math::PI)
+			return difference + 2.f * math::PI;
+		return difference;
+	}
+
+	// frame is of the scenario, not of a recording which keeps only some of them
+	void reportDivergence(const std::string &scenario, size_t frame, int id, const char *what, float expected, float actual)
+	{
+		GAME_LOG(game::LOG_ERROR, "Scenario %s diverges at frame %d (%.3f s), entity %d: %s expected %.6f, got %.6f",
+				 scenario.c_str(), static_cast<int>(frame), frame * STEP, id, what, expected, actual);
+	}
+
+	bool compareFrame(const std::string &scenario, size_t frame, const WorldSnapshot &reference, const WorldSnapshot &candidate,
+					  const trajectory_check::Tolerance &tolerance)
+	{
+		const std::vector<EntityPose> &expected = reference.entities;
+		const std::vector<EntityPose> &actual = candidate.entities;
+		if (expected.size() != actual.size())
+		{
+			reportDivergence(scenario, frame, -1, "entities count", static_cast<float>(expected.size()), static_cast<float>(actual.size()));
+			return false;
+		}
+
+		for (size_t i = 0; i < expected.size(); ++i)
+		{
+			const EntityPose &want = expected[i];
+			const EntityPose &got = actual[i];
+			if (want.id != got.id)
+			{
+				reportDivergence(scenario, frame, want.id, "id", want.id, got.id);
+				return false;
+			}
+			if (want.state != got.state)
+			{
+				reportDivergence(scenario, frame, want.id, "state", static_cast<float>(want.state), static_cast<float>(got.state));
+				return false;
+			}
+			if (!isFlying(want))
+				continue;
+			if (std::fabs(want.x - got.x) > tolerance.position)
+			{
+				reportDivergence(scenario, frame, want.id, "x", want.x, got.x);
+				return false;
+			}
+			if (std::fabs(want.y - got.y) > tolerance.position)
+			{
+				reportDivergence(scenario, frame, want.id, "y", want.y, got.y);
+				return false;
+			}
+			if (std::fabs(angleDifference(want.angle, got.angle)) > tolerance.angle)
+			{
+				reportDivergence(scenario, frame, want.id, "angle", want.angle, got.angle);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	template<class T>
+	void write(std::vector<char> &out, T value)
+	{
+		const char *bytes = reinterpret_cast<const char*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(value));
+	}
+
+	template<class T>
+	bool read(std::istream &in, T &value)
+	{
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+	}
+}
+
+
+namespace trajectory_check
+{
+	std::vector<Recording> recordAll(int frameStep)
+	{
+		std::vector<Recording> recordings;
+		for (const Scenario &scenario : scenarios())
+			recordings.push_back(run(scenario, frameStep));
+		return recordings;
+	}
+
+
+	bool save(const std::vector<Recording> &recordings, const char *path)
+	{
+		std::vector<char> out(MAGIC, MAGIC + sizeof(MAGIC));
+		write(out, static_cast<uint32_t>(recordings.size()));
+		for (const Recording &recording : recordings)
+		{
+			write(out, static_cast<uint32_t>(recording.scenario.size()));
+			out.insert(out.end(), recording.scenario.begin(), recording.scenario.end());
+			write(out, static_cast<uint32_t>(recording.frameStep));
+			write(out, static_cast<uint32_t>(recording.frames.size()));
+			for (const WorldSnapshot &frame : recording.frames)
+			{
+				write(out, static_cast<uint32_t>(frame.entities.size()));
+				for (const EntityPose &pose : frame.entities)
+				{
+					write(out, pose.id);
+					write(out, static_cast<uint8_t>(pose.kind));
+					write(out, static_cast<uint8_t>(pose.state));
+					write(out, pose.x);
+					write(out, pose.y);
+					write(out, pose.angle);
+				}
+			}
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.write(out.data(), out.size()))
+		{
+			GAME_LOG(game::LOG_ERROR, "Can not write trajectories to %s", path);
+			return false;
+		}
+		return true;
+	}
+
+
+	bool load(const char *path, std::vector<Recording> &recordings)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		const std::streamoff fileSize = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+		file.seekg(0);
+		char magic[sizeof(MAGIC)];
+		uint32_t count = 0;
+		if (!file.read(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !read(file, count))
+		{
+			GAME_LOG(game::LOG_ERROR, "%s is not a trajectories file", path);
+			return false;
+		}
+
+		// counts are checked against the bytes left before anything is sized by them
+		auto fits = [&file, fileSize](uint32_t items, size_t itemSize)
+		{
+			return static_cast<uint64_t>(items) * itemSize <= static_cast<uint64_t>(fileSize - file.tellg());
+		};
+
+		bool complete = fits(count, 3 * sizeof(uint32_t));
+		if (complete)
+			recordings.resize(count);
+		for (size_t r = 0; complete && r < recordings.size(); ++r)
+		{
+			Recording &recording = recordings[r];
+			uint32_t nameSize = 0;
+			uint32_t frameStep = 0;
+			uint32_t frames = 0;
+			complete = read(file, nameSize) && fits(nameSize, 1);
+			if (!complete)
+				break;
+			recording.scenario.resize(nameSize);
+			complete = (nameSize == 0 || file.read(&recording.scenario[0], nameSize)) && read(file, frameStep) &&
+				frameStep > 0 && read(file, frames) && fits(frames, sizeof(uint32_t));
+			if (!complete)
+				break;
+			recording.frameStep = static_cast<int>(frameStep);
+			recording.frames.resize(frames);
+			for (size_t f = 0; complete && f < recording.frames.size(); ++f)
+			{
+				WorldSnapshot &frame = recording.frames[f];
+				uint32_t entities = 0;
+				complete = read(file, entities) && fits(entities, ENTITY_RECORD_SIZE);
+				if (!complete)
+					break;
+				frame.entities.resize(entities);
+				for (EntityPose &pose : frame.entities)
+				{
+					uint8_t kind = 0;
+					uint8_t state = 0;
+					complete = read(file, pose.id) && read(file, kind) && read(file, state) &&
+						read(file, pose.x) && read(file, pose.y) && read(file, pose.angle);
+					if (!complete)
+						break;
+					pose.kind = static_cast<EntityKind>(kind);
+					pose.state = static_cast<AicraftState>(state);
+				}
+			}
+		}
+
+		if (!complete)
+		{
+			GAME_LOG(game::LOG_ERROR, "%s is truncated", path);
+			recordings.clear();
+			return false;
+		}
+		return true;
+	}
+
+
+	bool compare(const Recording &reference, const Recording &candidate, const Tolerance &tolerance)
+	{
+		if (reference.frameStep != candidate.frameStep)
+		{
+			reportDivergence(reference.scenario, 0, -1, "frame step", static_cast<float>(reference.frameStep), static_cast<float>(candidate.frameStep));
+			return false;
+		}
+
+		const size_t frames = std::min(reference.frames.size(), candidate.frames.size());
+		for (size_t frame = 0; frame < frames; ++frame)
+		{
+			if (!compareFrame(reference.scenario, frame * reference.frameStep, reference.frames[frame], candidate.frames[frame], tolerance))
+				return false;
+		}
+
+		if (reference.frames.size() != candidate.frames.size())
+		{
+			reportDivergence(reference.scenario, frames * reference.frameStep, -1, "frames count", static_cast<float>(reference.frames.size()),
+							 static_cast<float>(candidate.frames.size()));
+			return false;
+		}
+		return true;
+	}
+
+
+	int recordGolden(const char *path)
+	{
+		const std::vector<Recording> recordings = recordAll(GOLDEN_FRAME_STEP);
+		if (!save(recordings, path))
+			return 1;
+		GAME_LOG(game::LOG_INFO, "%d scenarios recorded to %s", static_cast<int>(recordings.size()), path);
+		return 0;
+	}
+
+
+	int checkStream()
+	{
+		// the stream keeps 1/512 of a unit and 1/65536 of a turn, ids and states go as they are
+		Tolerance tolerance;
+		tolerance.position = 0.5f / 512.f + 1e-4f;
+		tolerance.angle = math::PI / 65536.f + 1e-4f;
+
+		bool passed = true;
+		for (const Scenario &scenario : scenarios())
+		{
+			auto transports = LoopbackTransport::makePair();
+			WorldStreamPublisher publisher(std::move(transports.first));
+			WorldStreamClient client(std::move(transports.second));
+
+			Recording sent;
+			Recording received;
+			sent.scenario = received.scenario = scenario.name;
+			sent.frames.resize(framesCount(scenario));
+			received.frames.reserve(sent.frames.size());
+			World world;
+			play(scenario, [&](int frame)
+			{
+				if (received.frames.size() != static_cast<size_t>(frame))
+					return;
+				world.collectPoses(sent.frames[frame]);
+				publisher.snapshot() = sent.frames[frame];
+				publisher.publish();
+				if (awaitSequence(client, static_cast<uint32_t>(frame + 1)))
+					received.frames.push_back(client.getWorld());
+			}, world);
+
+			const bool matches = compare(sent, received, tolerance);
+			GAME_LOG(matches ? game::LOG_INFO : game::LOG_ERROR, "Scenario %s streamed: %s, %llu bytes in %llu packets",
+					 scenario.name, matches ? "matches" : "diverged", static_cast<unsigned long long>(publisher.getBytesSent()),
+					 static_cast<unsigned long long>(publisher.getPacketsSent()));
+			passed = passed && matches;
+		}
+		return passed ? 0 : 1;
+	}
+
+
+	int checkGolden(const char *path, const Tolerance &tolerance)
+	{
+		std::vector<Recording> references;
+		if (!load(path, references))
+			return 1;
+
+		bool passed = true;
+		for (const Recording &reference : references)
+		{
+			const Scenario *scenario = findScenario(reference.scenario);
+			if (!scenario)
+			{
+				GAME_LOG(game::LOG_ERROR, "Scenario %s is no longer there", reference.scenario.c_str());
+				passed = false;
+				continue;
+			}
+			const bool matches = compare(reference, run(*scenario, reference.frameStep), tolerance);
+			GAME_LOG(matches ? game::LOG_INFO : game::LOG_ERROR, "Scenario %s: %s", reference.scenario.c_str(), matches ? "matches" : "diverged");
+			passed = passed && matches;
+		}
+		latency_tracker::logSummary();
+		return passed ? 0 : 1;
+	}
+
+
+	// both worlds take the same commands and steps, so the first frame they differ in is where the scheduled
+	// step stopped flying like the plain one
+	int checkReference(const Tolerance &tolerance)
+	{
+		bool passed = true;
+		for (const Scenario &scenario : scenarios())
+		{
+			World world;
+			reference_flight::World reference;
+			WorldSnapshot expected;
+			WorldSnapshot actual;
+			bool matches = true;
+			play(scenario, [&](int frame)
+			{
+				if (!matches)
+					return;
+				expected.entities.clear();
+				actual.entities.clear();
+				reference.collectPoses(expected);
+				world.collectPoses(actual);
+				matches = compareFrame(scenario.name, frame, expected, actual, tolerance);
+			}, world, reference);
+
+			GAME_LOG(matches ? game::LOG_INFO : game::LOG_ERROR, "Scenario %s against the reference: %s", scenario.name,
+					 matches ? "matches" : "diverged");
+			passed = passed && matches;
+		}
+		return passed ? 0 : 1;
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "../game_cpp/world_stream.hpp"
+
+#include <string>
+#include <vector>
+
+
+//-------------------------------------------------------
+//	Trajectory checks
+//	scripted scenarios run through the world with a fixed step and the poses
+//	of ships and aircrafts are compared frame by frame: with reference_flight,
+//	the plain step the scheduled one has to keep flying like, and with the
+//	golden recording in the repository, which is recorded again only by a change
+//	meant to alter the flights.
+//-------------------------------------------------------
+
+namespace trajectory_check
+{
+	struct Tolerance
+	{
+		float position = 1e-4f;
+		float angle = 1e-4f;
+	};
+
+	struct Recording
+	{
+		std::string scenario;
+		// every frameStep-th frame of the scenario is kept, starting with the first one
+		int frameStep = 1;
+		std::vector<WorldSnapshot> frames;
+	};
+
+	// runs every built-in scenario from a fresh world
+	std::vector<Recording> recordAll(int frameStep = 1);
+
+	bool save(const std::vector<Recording> &recordings, const char *path);
+	bool load(const char *path, std::vector<Recording> &recordings);
+
+	// logs the first frame where the candidate leaves the reference, returns false if there is one;
+	// both are expected to keep frames with the same step
+	bool compare(const Recording &reference, const Recording &candidate, const Tolerance &tolerance);
+
+	// entry points of the tests, return the process exit code
+	int recordGolden(const char *path);
+	int checkGolden(const char *path, const Tolerance &tolerance);
+	// plays the scenarios through World and reference_flight::World side by side
+	int checkReference(const Tolerance &tolerance);
+	// plays the scenarios through WorldStreamPublisher, a loopback and WorldStreamClient,
+	// the client has to see every frame as collectPoses gave it, within the quantization
+	int checkStream();
+}